@@ -1,4 +1,7 @@
+#pragma once
+
 #include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
 #include <variant>
 #include <util.hpp>
 
@@ -20,46 +23,41 @@ typedef std::variant<std::monostate, uint64_t, int64_t, double, name, asset, str
     typedef eosio::multi_index<"config"_n, config_table> config_tables;
 
 
-#define DEFINE_CONFIG_GET \
-      uint64_t config_get_uint64 (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<uint64_t>(citr->value);\
-      } \
-      int64_t config_get_int64 (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<int64_t>(citr->value);\
-      } \
-      double config_get_double (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<double>(citr->value);\
-      } \
-      name config_get_name (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<name>(citr->value);\
-      } \
-      asset config_get_asset (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<asset>(citr->value);\
-      } \
-      string config_get_string (name key) { \
-            auto citr = config.find(key.value);\
-            if (citr == config.end()) { \
-                  eosio::check(false, ("settings: the "+key.to_string()+" parameter has not been initialized").c_str());\
-            }\
-            return std::get<string>(citr->value);\
+// Typed settings stored as a single packed singleton row. The row is read
+// at most once per action and kept in memory, values are validated when
+// they are written (setparam) so readers don't need any checks.
+template <typename Singleton, typename Settings>
+class cached_settings {
+
+  public:
+    cached_settings(name code, uint64_t scope)
+      : table(code, scope)
+      {}
+
+    const Settings & get() {
+      if (!loaded) {
+        value = table.get_or_default(Settings{});
+        loaded = true;
       }
+      return value;
+    }
+
+    void set(const Settings & new_value, const name & payer) {
+      table.set(new_value, payer);
+      value = new_value;
+      loaded = true;
+    }
+
+    void remove() {
+      if (table.exists()) {
+        table.remove();
+      }
+      value = Settings{};
+      loaded = true;
+    }
+
+  private:
+    Singleton table;
+    Settings value;
+    bool loaded = false;
+};
@@ -5,6 +5,7 @@
 #include <contracts.hpp>
 #include <util.hpp>
 #include <common.hpp>
+#include <config.hpp>
 
 #include <graph_common.hpp>
 #include <document_graph/content.hpp>
@@ -13,6 +14,11 @@
 #include <document_graph/util.hpp>
 #include <document_graph/content_wrapper.hpp>
 #include <document_graph/document_graph.hpp>
+#include <graph_traversal.hpp>
+#include <edge_writer.hpp>
+#include <group_store.hpp>
+#include <string_codec.hpp>
+#include <value_index.hpp>
 
 using namespace eosio;
 // using namespace utils;
@@ -20,41 +26,105 @@ using std::string;
 
 typedef std::variant<asset, string, time_point, name, int64_t> ContentVariant;
 
+// contents to insert or replace in one content group of a dao info node
+struct dao_entry {
+  uint64_t dao_id;
+  string group_label;
+  std::vector<hypha::Content> contents;
+};
+
 CONTRACT daoinf : public contract {
 
   public:
     using contract::contract;
     daoinf(name receiver, name code, datastream<const char*> ds)
-      : contract(receiver, code, ds)
+      : contract(receiver, code, ds),
+        graph_params(receiver, receiver.value)
         {}
     
     DECLARE_DOCUMENT_GRAPH(daoinf)
 
+    TABLE daoindex { // current info node of every dao
+      uint64_t dao_id;
+      checksum256 info_hash;
+      time_point created_date;
+
+      uint64_t primary_key () const { return dao_id; }
+      uint128_t by_created () const { return (uint128_t(created_date.sec_since_epoch()) << 64) + dao_id; }
+    };
+
+    typedef multi_index<name("daoindex"), daoindex,
+      indexed_by<name("bycreated"),
+      const_mem_fun<daoindex, uint128_t, &daoindex::by_created>>
+    >dao_index_table;
+
     ACTION reset();
 
+    ACTION setgraphcfg(const bool & dedup_groups, const uint32_t & compress_min_length);
+
     ACTION adddao(const name & creator, const uint64_t & dao_id) ;
 
+    ACTION deldao(const uint64_t & dao_id, const uint64_t & max_edges);
+
     ACTION storeentry(const std::vector<hypha::Content> & values, const uint64_t &dao_id);
 
+    ACTION storeentries(const std::vector<dao_entry> & entries);
+
     ACTION delentry(const std::vector<string> & labels, const uint64_t &dao_id);
 
+    // read only, prints one page of dao info nodes
+    ACTION listdaos(const uint64_t & cursor, const uint32_t & limit, const bool & by_created);
+
+    // adds the missing daoindex rows of a range of dao ids, prints the next id to continue from
+    ACTION indexdaos(const uint64_t & start_dao_id, const uint64_t & max_daos);
+
+    // documents written from now on are indexed by the value of this content
+    ACTION setindexed(const string & group_label, const string & content_label, const bool & indexed);
+
+    // read only, prints the hashes of the documents holding content
+    ACTION finddocs(const string & group_label, const hypha::Content & content, const uint32_t & limit);
+
+    // ingests packed rows of one table of a graph snapshot, see scripts/snapshot.js
+    ACTION bulkload(const name & table, const std::vector<std::vector<char>> & rows);
+
   private:
 
     int64_t active_cutoff_date();
-    hypha::Document get_root_node();
-    hypha::Document get_dao_node();
+    checksum256 get_root_hash();
+    checksum256 get_daos_hash();
     hypha::Document get_dao_inf_node(const uint64_t & dao_id);
-    hypha::Document get_doc_from_edge(const checksum256 & node_hash, const name & edge_name);
-    void update_node(hypha::Document * node_doc, const string & content_group_label, const std::vector<hypha::Content> & new_contents);
+    checksum256 get_dao_inf_hash(const uint64_t & dao_id);
+    void index_dao(const uint64_t & dao_id, const checksum256 & info_hash, const time_point & created_date);
+    checksum256 get_hash_from_edge(const checksum256 & node_hash, const name & edge_name);
+    void update_node(hypha::Document * node_doc, const hypha::ContentGroups & stored_groups, const uint64_t & dao_id, const string & content_group_label, const std::vector<hypha::Content> & new_contents);
+    hypha::ContentGroups expand_node(hypha::Document & node_doc);
+    void write_node(hypha::Document & node_doc, const hypha::ContentGroups & stored_groups, const uint64_t & dao_id);
+    void check_contents(const std::vector<hypha::Content> & contents);
+    bool merge_contents(hypha::ContentGroup & content_group, const std::vector<hypha::Content> & new_contents);
     bool edge_exists(const checksum256 & from_node_hash, const name & edge_name);
+    void load_documents(const std::vector<std::vector<char>> & rows);
+    void load_edges(const std::vector<std::vector<char>> & rows);
+    void load_index_rows(const std::vector<std::vector<char>> & rows);
 
     hypha::DocumentGraph m_documentGraph = hypha::DocumentGraph(get_self());
+    hypha::GraphTraversal m_graphTraversal = hypha::GraphTraversal(get_self());
+    hypha::GroupStore m_groupStore = hypha::GroupStore(get_self());
+
+    TABLE graph_config {
+      bool dedup_groups = false; // store content groups once, referenced by hash
+      uint32_t compress_min_length = 0; // compress longer strings, 0 disables
+    };
+
+    typedef eosio::singleton<name("graphconfig"), graph_config> graph_config_table;
+
+    cached_settings<graph_config_table, graph_config> graph_params;
 };
 
 extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action) {
   switch (action) {
     EOSIO_DISPATCH_HELPER(daoinf, (reset)
-      (storeentry)(delentry)(adddao)
+      (setgraphcfg)(storeentry)(storeentries)(delentry)(adddao)(deldao)(listdaos)(indexdaos)
+      (setindexed)(finddocs)(bulkload)
     )
   }
 }
@@ -4,9 +4,12 @@
 #include <eosio/singleton.hpp>
 #include <contracts.hpp>
 #include <tables/users.hpp>
+#include <tables/payment_methods.hpp>
 #include <config.hpp>
 #include <util.hpp>
 #include <common.hpp>
+#include <pricing.hpp>
+#include <memo.hpp>
 
 using namespace eosio;
 
@@ -16,7 +19,8 @@ CONTRACT daoreg : public contract {
     using contract::contract;
     daoreg(name receiver, name code, datastream<const char*> ds)
       : contract(receiver, code, ds),
-        config(receiver, receiver.value)
+        config(receiver, receiver.value),
+        params(receiver, receiver.value)
         {}
 
     ACTION reset(std::vector<name> users);
@@ -55,18 +59,50 @@ CONTRACT daoreg : public contract {
       const name & token_contract, 
       const symbol & token);
 
+    // rebuilds tokenreg from the tokens of every dao, a start_dao_id of 0 clears it first
+    ACTION syncregistry(
+      const uint64_t & start_dao_id,
+      const uint64_t & max_daos);
+
     [[eosio::on_notify("*::transfer")]] 
     void deposit(
       const name & from, 
       const name & to, 
       const asset & quantity, 
       const std::string & memo);
+
+    // entry of a tlostoken::transfermany payload
+    struct transfer_entry {
+      name to;
+      asset quantity;
+      string memo;
+    };
+
+    // batched transfers, every entry addressed to daoreg is a deposit
+    [[eosio::on_notify("*::transfermany")]]
+    void depositmany(
+      const name & from,
+      const std::vector<transfer_entry> & transfers);
         
     ACTION withdraw(
       const name & account, 
-      const name & dao, 
+      const name & token_account, 
       const asset & quantity);
 
+    ACTION withdrawmany(
+      const name & account, 
+      const std::vector<std::pair<name, asset>> & withdrawals);
+
+    ACTION compactbal(
+      const name & account,
+      const uint64_t & start_id,
+      const uint64_t & max_rows);
+
+    ACTION transferbatch(
+      const name & from, 
+      const uint64_t & dao_id, 
+      const std::vector<std::pair<name, asset>> & transfers);
+
     ACTION createoffer (
       const uint64_t & dao_id, 
       const name & creator, 
@@ -83,19 +119,164 @@ CONTRACT daoreg : public contract {
       const name & account,
       const uint64_t & offer_id);
 
+    ACTION amendoffer (
+      const uint64_t & dao_id, 
+      const uint64_t & offer_id,
+      const asset & new_quantity,
+      const asset & new_price);
+
+    ACTION upsertuser (
+      const name & account,
+      const mapss & contact_methods,
+      const name & time_zone,
+      const name & fiat_currency);
+
+    ACTION deluser (
+      const name & account);
+
+    ACTION addpaymethod (
+      const name & account,
+      const name & method,
+      const std::string & details);
+
+    ACTION delpaymethod (
+      const name & account,
+      const name & method);
+
+    ACTION setarbiter (
+      const name & account,
+      const bool & is_arbiter);
+
+    ACTION opentrade (
+      const uint64_t & dao_id,
+      const name & seller,
+      const name & buyer,
+      const asset & quantity,
+      const asset & fiat_amount,
+      const name & payment_method,
+      const name & arbiter);
+
+    ACTION confirmpaid (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id);
+
+    ACTION releasetrade (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id);
+
+    ACTION canceltrade (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id,
+      const name & account);
+
+    ACTION disputetrade (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id,
+      const name & account);
+
+    ACTION resolvetrade (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id,
+      const bool & release);
+
+    // event actions, only callable inline by this contract so indexers can
+    // follow state changes from action traces
+    ACTION logdeposit (
+      const name & account,
+      const uint64_t & dao_id,
+      const name & token_account,
+      const asset & quantity);
+
+    ACTION logwithdraw (
+      const name & account,
+      const name & token_account,
+      const asset & quantity);
+
+    ACTION lognewoffer (
+      const uint64_t & dao_id,
+      const uint64_t & offer_id,
+      const name & creator,
+      const asset & quantity,
+      const asset & price_per_unit,
+      const uint8_t & type);
+
+    ACTION logfill (
+      const uint64_t & dao_id,
+      const uint64_t & offer_id,
+      const name & maker,
+      const name & taker,
+      const asset & quantity,
+      const asset & cost);
+
+    ACTION logcancel (
+      const uint64_t & dao_id,
+      const uint64_t & offer_id,
+      const name & creator,
+      const asset & remaining);
+
+    ACTION logamend (
+      const uint64_t & dao_id,
+      const uint64_t & offer_id,
+      const name & creator,
+      const asset & quantity,
+      const asset & price_per_unit);
+
+    ACTION logsettle (
+      const uint64_t & dao_id,
+      const uint64_t & trade_id,
+      const name & seller,
+      const name & buyer,
+      const asset & quantity,
+      const name & beneficiary);
+
   private:
 
     DEFINE_CONFIG_TABLE
-    DEFINE_CONFIG_GET
 
     DEFINE_USERS_TABLE
+    DEFINE_PAYMENT_METHODS_TABLE
+
+    TABLE settings {
+      uint64_t ram_bytes = 0; // b.rambytes
+      asset delegated_net; // d.net
+      asset delegated_cpu; // d.cpu
+      name log_account; // log.account
+      bool erase_empty_balances = false; // erase.empty
+      name info_account; // info.account
+      uint32_t trade_payment_window = util::trade_payment_window; // trade.window
+      uint64_t initialized = 0; // one param_bit per key set through setparam
+    };
+
+    typedef eosio::singleton<name("settings"), settings> settings_table;
 
     config_tables config;
+    cached_settings<settings_table, settings> params;
 
     typedef std::variant<std::monostate, uint64_t, int64_t, double, name, asset, string> VariantValue;
 
     std::vector<std::pair<name, symbol>> system_tokens = {{name("eosio.token"), symbol("TLOS", 4)}};
 
+    template <typename... T>
+    void emit_event(const name & event, const T&... payload) {
+      action(
+        permission_level(get_self(), name("active")),
+        get_self(),
+        event,
+        std::make_tuple(payload...)
+      ).send();
+    }
+
+    void notify_log_account();
+
+    void require_params(std::initializer_list<name> keys);
+
+    uint64_t param_bit(const name & key);
+
+    void apply_param(
+      settings & current,
+      const name & key,
+      const VariantValue & value);
+
     void token_exists(
       const uint64_t & dao_id, 
       const asset & quantity);
@@ -105,16 +286,49 @@ CONTRACT daoreg : public contract {
       const name & account, 
       const asset & quantity);
 
+    asset get_available(
+      const name & account, 
+      const name & token_account, 
+      const symbol & token_symbol);
+
     void resolve_buy_offer(
       const uint64_t & dao_id,
-      const uint8_t & offer_id,
+      const uint64_t & offer_id,
       const name & seller);
 
     void resolve_sell_offer(
       const uint64_t & dao_id,
-      const uint8_t & offer_id,
+      const uint64_t & offer_id,
       const name & buyer);
 
+    asset fill_offer(
+      const uint64_t & dao_id,
+      const uint64_t & offer_id,
+      const name & taker,
+      const asset & quantity);
+
+    std::pair<asset, asset> sweep_offers(
+      const uint64_t & dao_id,
+      const name & taker,
+      const uint8_t & token_idx,
+      const uint8_t & taker_type,
+      const asset & max_quantity,
+      const asset & max_cost,
+      const asset & limit_price);
+
+    bool crosses_book(
+      const uint64_t & dao_id,
+      const uint8_t & token_idx,
+      const uint8_t & type,
+      const asset & price);
+
+    void deposit_and_trade(
+      const name & from,
+      const uint64_t & dao_id,
+      const asset & quantity,
+      const name & token_account,
+      std::string_view args);
+
     void add_balance(
       const name & account, 
       const asset & quantity, 
@@ -127,6 +341,21 @@ CONTRACT daoreg : public contract {
       const name & token_account,
       const uint64_t & dao_id);
 
+    void lock_balance(
+      const name & account, 
+      const asset & quantity, 
+      const name & token_account);
+
+    void unlock_balance(
+      const name & account, 
+      const asset & quantity, 
+      const name & token_account);
+
+    void settle_trade(
+      const uint64_t & dao_id,
+      const uint64_t & trade_id,
+      const name & beneficiary);
+
     void send_transfer(
       const name & beneficiary, 
       const asset & quantity, 
@@ -142,13 +371,7 @@ CONTRACT daoreg : public contract {
 
     void close_offer(
       const uint64_t & dao_id,
-      const uint8_t & offer_id);
-
-    void transfer(
-      const name & from, 
-      const name & to, 
-      const asset & quantity, 
-      const uint64_t & dao_id);
+      const uint64_t & offer_id);
 
     void createbuyoffer ( 
       const uint64_t & dao_id, 
@@ -164,6 +387,15 @@ CONTRACT daoreg : public contract {
       const asset & price_per_unit,
       const uint8_t & token_id);
 
+    void takeoffers ( 
+      const uint64_t & dao_id, 
+      const name & creator, 
+      const asset & quantity, 
+      const asset & limit_price,
+      const uint8_t & token_id,
+      const uint8_t & taker_type,
+      const bool & fill_or_kill);
+
     void storeoffer ( 
       const uint64_t & dao_id, 
       const name & creator, 
@@ -177,6 +409,13 @@ CONTRACT daoreg : public contract {
       const uint64_t & dao_id, 
       const symbol & token_symbol);
 
+    void record_trade(
+      const uint64_t & dao_id,
+      const uint8_t & token_idx,
+      const asset & price_per_unit,
+      const asset & quantity,
+      const asset & cost);
+
     TABLE daos {
       uint64_t dao_id;
       name dao;
@@ -230,6 +469,15 @@ CONTRACT daoreg : public contract {
       const_mem_fun<tokens, uint64_t, &tokens::by_token_symbol>>
     >tokens_table;
 
+    TABLE tokenregistry { // scoped by contract
+      name token_account;
+      uint64_t tokens; // number of dao tokens registered for this contract
+
+      uint64_t primary_key () const { return token_account.value; }
+    };
+
+    typedef multi_index<name("tokenreg"), tokenregistry> token_registry_table;
+
     TABLE offers {  // scoped by dao_id
       uint64_t offer_id;
       name creator;
@@ -245,13 +493,20 @@ CONTRACT daoreg : public contract {
       
       uint64_t primary_key () const { return offer_id; }
 
+      // asks are walked upwards and bids downwards, so asks store the creation
+      // time and bids its complement to fill the oldest offer of a price level first
+      uint64_t time_priority () const {
+        uint64_t created = creation_date.sec_since_epoch();
+        return type == util::type_buy_offer ? std::numeric_limits<uint64_t>::max() - created : created;
+      }
+
       uint128_t by_offer_match () const {
          return
               (uint128_t(0xF                & type                 ) << 124) 
             + (uint128_t(0xF                & status               ) << 122) 
             + (uint128_t(0xF                & token_idx            ) << 120)
             + (uint128_t(0xFFFFFFFFFFFFFFFF & price_per_unit.amount) << 56 ) 
-            + (uint128_t(0xFFFFFFFFFFFFFF   & (std::numeric_limits<uint64_t>::max() - creation_date.sec_since_epoch()) ) );
+            + (uint128_t(0xFFFFFFFFFFFFFF   & time_priority()      ) );
             }  
     };
 
@@ -260,6 +515,70 @@ CONTRACT daoreg : public contract {
       const_mem_fun<offers, uint128_t, &offers::by_offer_match>>
     >offers_table;
 
+    TABLE candles { // scoped by dao_id, ring buffer per (token, interval)
+      uint64_t id;
+      uint8_t token_idx;
+      uint32_t interval; // seconds
+      time_point_sec bucket_start;
+      asset open;
+      asset high;
+      asset low;
+      asset close;
+      asset volume; // daos token
+      asset quote_volume; // system token
+      uint32_t trades;
+
+      uint64_t primary_key () const { return id; }
+      uint128_t by_token_interval_time () const { 
+        return (uint128_t(token_idx) << 96) + (uint128_t(interval) << 64) + bucket_start.sec_since_epoch(); 
+      }
+    };
+
+    typedef multi_index<name("candles"), candles,
+      indexed_by<name("bytknintrvl"),
+      const_mem_fun<candles, uint128_t, &candles::by_token_interval_time>>
+    >candles_table;
+
+    TABLE lasttrades { // scoped by dao_id
+      uint8_t token_idx;
+      asset price_per_unit;
+      asset quantity;
+      time_point trade_date;
+
+      uint8_t primary_key () const { return token_idx; }
+    };
+
+    typedef multi_index<name("lasttrades"), lasttrades> lasttrades_table;
+
+    TABLE trades { // scoped by dao_id, erased once settled
+      uint64_t trade_id;
+      name seller;
+      name buyer;
+      name arbiter;
+      asset quantity; // locked in the seller's balance
+      asset fiat_amount;
+      name payment_method;
+      name token_account;
+      uint8_t status;
+      time_point_sec payment_deadline;
+
+      uint64_t primary_key () const { return trade_id; }
+      uint128_t by_seller () const { return (uint128_t(seller.value) << 64) + trade_id; }
+      uint128_t by_buyer () const { return (uint128_t(buyer.value) << 64) + trade_id; }
+      uint128_t by_arbiter_status () const { 
+        return (uint128_t(arbiter.value) << 64) + (uint128_t(0xFF & status) << 56) + (0xFFFFFFFFFFFFFF & trade_id); 
+      }
+    };
+
+    typedef multi_index<name("trades"), trades,
+      indexed_by<name("byseller"),
+      const_mem_fun<trades, uint128_t, &trades::by_seller>>,
+      indexed_by<name("bybuyer"),
+      const_mem_fun<trades, uint128_t, &trades::by_buyer>>,
+      indexed_by<name("byarbstatus"),
+      const_mem_fun<trades, uint128_t, &trades::by_arbiter_status>>
+    >trades_table;
+
 
 
 
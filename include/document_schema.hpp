@@ -0,0 +1,116 @@
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+#include <document_graph/content.hpp>
+
+// Compile-time document schemas. A schema lists its fields once, as
+// (group label, content label, required) plus a tuple with the type of each
+// field, and names every field by its position:
+//
+//	struct my_schema {
+//		static constexpr size_t title = 0;
+//		using types = std::tuple<std::string>;
+//		static constexpr std::array<schema::field, 1> fields = {{ {"details", "title", true} }};
+//	};
+//
+// A view indexes the contents of a document in one pass, after that every
+// get<my_schema::title>() is an array access resolved at compile time.
+namespace schema
+{
+	struct field {
+		std::string_view group;
+		std::string_view label;
+		bool required;
+	};
+
+	template <typename Schema, size_t Field>
+	using field_type = std::tuple_element_t<Field, typename Schema::types>;
+
+	template <typename Schema>
+	class view {
+
+		public:
+			static constexpr size_t field_count = Schema::fields.size();
+
+			static_assert(std::tuple_size_v<typename Schema::types> == field_count, "schema: one type per field");
+
+			explicit view(const hypha::ContentGroups & content_groups) {
+				for (const hypha::ContentGroup & content_group : content_groups) {
+					std::string_view group = group_label(content_group);
+					if (group.empty()) continue;
+
+					for (const hypha::Content & content : content_group) {
+						for (size_t i = 0; i < field_count; ++i) {
+							if (contents[i] == nullptr && Schema::fields[i].group == group && Schema::fields[i].label == content.label) {
+								contents[i] = &content;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			template <size_t Field>
+			bool has() const {
+				static_assert(Field < field_count, "schema: unknown field");
+				return contents[Field] != nullptr;
+			}
+
+			template <size_t Field>
+			const field_type<Schema, Field> & get() const {
+				static_assert(Field < field_count, "schema: unknown field");
+				if (contents[Field] == nullptr) fail("missing", Field);
+
+				auto value = std::get_if<field_type<Schema, Field>>(&contents[Field]->value);
+				if (value == nullptr) fail("wrong type for", Field);
+
+				return *value;
+			}
+
+			// required fields are present and every present field has its declared type
+			void validate() const {
+				validate_fields(std::make_index_sequence<field_count>{});
+			}
+
+		private:
+			std::array<const hypha::Content *, field_count> contents{};
+
+			static std::string_view group_label(const hypha::ContentGroup & content_group) {
+				for (const hypha::Content & content : content_group) {
+					if (content.label == hypha::CONTENT_GROUP_LABEL) {
+						auto label = std::get_if<std::string>(&content.value);
+						return label ? std::string_view(*label) : std::string_view();
+					}
+				}
+				return {};
+			}
+
+			template <size_t... Fields>
+			void validate_fields(std::index_sequence<Fields...>) const {
+				(validate_field<Fields>(), ...);
+			}
+
+			template <size_t Field>
+			void validate_field() const {
+				if (contents[Field] == nullptr) {
+					if (Schema::fields[Field].required) fail("missing", Field);
+					return;
+				}
+				if (!std::holds_alternative<field_type<Schema, Field>>(contents[Field]->value)) fail("wrong type for", Field);
+			}
+
+			// the message is only built on failure
+			[[noreturn]] static void fail(const char * reason, size_t field) {
+				eosio::check(false, std::string("schema: ") + reason + " " +
+					std::string(Schema::fields[field].group) + "." + std::string(Schema::fields[field].label));
+				__builtin_unreachable();
+			}
+	};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+
+#include <vector>
+
+#include <document_graph/edge.hpp>
+
+namespace hypha
+{
+    struct EdgeSpec
+    {
+        eosio::checksum256 fromNode;
+        eosio::checksum256 toNode;
+        eosio::name edgeName;
+    };
+
+    // Writes a batch of edges through one edge_table handle. Readable hashes
+    // are built once per node and the from/to index once per node pair;
+    // duplicates, in the batch or already stored, fail the whole batch.
+    void writeEdges(const eosio::name &contract, const eosio::name &creator, const std::vector<EdgeSpec> &edges);
+
+} // namespace hypha
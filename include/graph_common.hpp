@@ -1,6 +1,7 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
+#include <document_schema.hpp>
 
 using namespace eosio;
 
@@ -25,7 +26,27 @@ namespace graph {
   #define IDENTIFIER_DETAILS "identifier_details"
   #define OWNER "owner"
   #define CREATOR "creator"
+  #define DAO_ID "dao_id"
   #define TYPE "type"
   #define TITLE "title"
   #define NODE_HASH "node_hash"
+
+  // layout of a dao info node, checked before every write
+  struct dao_info_schema {
+    static constexpr size_t creator = 0;
+    static constexpr size_t owner = 1;
+    static constexpr size_t dao_id = 2;
+    static constexpr size_t variable_owner = 3;
+
+    using types = std::tuple<name, name, int64_t, name>;
+
+    static constexpr std::array<schema::field, 4> fields = {{
+      { FIXED_DETAILS, CREATOR, true },
+      { FIXED_DETAILS, OWNER, true },
+      { FIXED_DETAILS, DAO_ID, false }, // nodes created before dao ids were stored lack it
+      { VARIABLE_DETAILS, OWNER, true }
+    }};
+  };
+
+  typedef schema::view<dao_info_schema> dao_info_view;
 }
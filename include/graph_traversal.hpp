@@ -0,0 +1,65 @@
+#pragma once
+
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <document_graph/document.hpp>
+#include <document_graph/edge.hpp>
+
+namespace hypha
+{
+    struct TraversalOptions
+    {
+        // hops from the start node, the start node itself is depth 0
+        uint8_t maxDepth = 1;
+
+        // only follow edges with one of these names, follow every edge when empty
+        std::vector<eosio::name> edgeNames;
+
+        // nodes handed to the visitor before the traversal stops
+        uint32_t maxVisits = 100;
+
+        // load and verify the Document of every visited node
+        bool loadDocuments = false;
+    };
+
+    struct TraversalNode
+    {
+        eosio::checksum256 hash;
+        uint8_t depth;
+
+        // edge used to reach the node, empty for the start node
+        eosio::name edgeName;
+
+        // only set when TraversalOptions::loadDocuments is on
+        std::optional<Document> document;
+    };
+
+    // breadth-first walk over the edge table that works on hashes, the
+    // visitor returns false to stop early
+    class GraphTraversal
+    {
+    public:
+        using Visitor = std::function<bool(const TraversalNode &)>;
+
+        GraphTraversal(const eosio::name &contract);
+
+        // returns the number of nodes handed to the visitor
+        uint32_t bfs(const eosio::checksum256 &start, const TraversalOptions &options, const Visitor &visitor);
+
+        // hashes of the nodes reachable from start, the start node excluded
+        std::vector<eosio::checksum256> reachable(const eosio::checksum256 &start, const TraversalOptions &options);
+
+    private:
+        void expand(const TraversalNode &node,
+                    const TraversalOptions &options,
+                    const std::function<bool(const Edge &)> &onEdge);
+
+        eosio::name m_contract;
+    };
+
+} // namespace hypha
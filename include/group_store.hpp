@@ -0,0 +1,82 @@
+#pragma once
+
+#include <eosio/crypto.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+
+#include <optional>
+#include <string>
+
+#include <document_graph/content.hpp>
+#include <document_graph/document.hpp>
+
+namespace hypha
+{
+    // label of the content that points a stub group to its stored copy
+    inline const std::string GROUP_REF_LABEL = "group_ref";
+
+    struct [[eosio::table]] StoredGroup
+    {
+        uint64_t id;
+        eosio::checksum256 hash;
+        ContentGroup content_group;
+
+        uint64_t primary_key() const { return id; }
+        eosio::checksum256 by_hash() const { return hash; }
+
+        EOSLIB_SERIALIZE(StoredGroup, (id)(hash)(content_group))
+    };
+
+    typedef eosio::multi_index<eosio::name("groups"), StoredGroup,
+        eosio::indexed_by<eosio::name("byhash"),
+        eosio::const_mem_fun<StoredGroup, eosio::checksum256, &StoredGroup::by_hash>>
+    > group_table;
+
+    // kept apart from the group so a new reference rewrites 16 bytes, not the group
+    struct [[eosio::table]] GroupRefs
+    {
+        uint64_t group_id;
+        uint64_t refs;
+
+        uint64_t primary_key() const { return group_id; }
+
+        EOSLIB_SERIALIZE(GroupRefs, (group_id)(refs))
+    };
+
+    typedef eosio::multi_index<eosio::name("grouprefs"), GroupRefs> group_refs_table;
+
+    // Content-addressed store for content groups. A document written through
+    // the store keeps small stub groups, {content_group_label, group_ref}, and
+    // identical groups are stored once with a reference count.
+    class GroupStore
+    {
+    public:
+        GroupStore(const eosio::name &contract);
+
+        // stores every group and returns the stubs to save in the document,
+        // compressMinLength is handed to string_codec::compressGroup
+        ContentGroups store(const ContentGroups &contentGroups, uint32_t compressMinLength);
+
+        // swaps stubs for their stored groups, other groups are kept as they are
+        ContentGroups expand(const ContentGroups &contentGroups);
+
+        // drops one reference for every stub
+        void release(const ContentGroups &contentGroups);
+
+        // returns what to save for newGroups, only groups that differ from the
+        // stubs in previous gain or lose a reference; with dedup off the
+        // previous stubs are released and newGroups are returned as they are
+        ContentGroups replace(const ContentGroups &previous, ContentGroups newGroups, bool dedup, uint32_t compressMinLength);
+
+        static bool hasReferences(const ContentGroups &contentGroups);
+        static std::optional<eosio::checksum256> getReference(const ContentGroup &contentGroup);
+
+    private:
+        ContentGroup makeStub(const ContentGroup &contentGroup, const eosio::checksum256 &hash);
+        void acquire(const eosio::checksum256 &hash, const ContentGroup &contentGroup, uint64_t count, uint32_t compressMinLength);
+        void release(const eosio::checksum256 &hash, uint64_t count);
+
+        eosio::name m_contract;
+    };
+
+} // namespace hypha
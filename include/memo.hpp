@@ -0,0 +1,141 @@
+#pragma once
+
+#include <eosio/name.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <string_view>
+#include <limits>
+
+using namespace eosio;
+
+namespace memo
+{
+	// deposit routes
+	const uint8_t route_credit = 0; // "<dao_id>" or "<dao_id>:<account>"
+	const uint8_t route_offer = 1;  // "<dao_id>:offer:<price>[:<token>][:w]"
+
+	struct deposit_memo {
+		uint64_t dao_id = 0;
+		name beneficiary;
+		uint8_t route = route_credit;
+		std::string_view args;
+	};
+
+	// "<price>[:<token>][:w]", price uses the system token precision, token is
+	// the daos token to buy with system tokens, w sends the proceeds back
+	struct offer_memo {
+		int64_t price = 0;
+		symbol_code token;
+		bool withdraw = false;
+	};
+
+	// decimal digits only, no sign, no spaces, no overflow
+	inline bool parse_uint64(std::string_view str, uint64_t & result) {
+		if (str.empty() || str.size() > 20) return false;
+
+		uint64_t value = 0;
+		for (char c : str) {
+			if (c < '0' || c > '9') return false;
+			uint64_t digit = uint64_t(c - '0');
+			if (value > (std::numeric_limits<uint64_t>::max() - digit) / 10) return false;
+			value = value * 10 + digit;
+		}
+
+		result = value;
+		return true;
+	}
+
+	// valid eosio account name characters, at most 12 of them
+	inline bool is_name(std::string_view str) {
+		if (str.empty() || str.size() > 12) return false;
+
+		for (char c : str) {
+			if (!((c >= 'a' && c <= 'z') || (c >= '1' && c <= '5') || c == '.')) return false;
+		}
+
+		return str.back() != '.';
+	}
+
+	// "12.5" with precision 4 is 125000, no more decimals than precision allowed
+	inline bool parse_amount(std::string_view str, uint8_t precision, int64_t & result) {
+		size_t dot = str.find('.');
+		std::string_view whole = str.substr(0, dot);
+		std::string_view fraction = dot == std::string_view::npos ? std::string_view() : str.substr(dot + 1);
+
+		if (dot != std::string_view::npos && fraction.empty()) return false;
+		if (fraction.size() > precision) return false;
+
+		uint64_t whole_value = 0, fraction_value = 0;
+		if (!parse_uint64(whole, whole_value)) return false;
+		if (!fraction.empty() && !parse_uint64(fraction, fraction_value)) return false;
+
+		uint64_t scale = 1;
+		for (uint8_t i = 0; i < precision; i++) scale *= 10;
+		for (size_t i = fraction.size(); i < precision; i++) fraction_value *= 10;
+
+		if (whole_value > (uint64_t(asset::max_amount) - fraction_value) / scale) return false;
+
+		result = int64_t(whole_value * scale + fraction_value);
+		return true;
+	}
+
+	inline bool is_symbol_code(std::string_view str) {
+		if (str.empty() || str.size() > 7) return false;
+
+		for (char c : str) {
+			if (c < 'A' || c > 'Z') return false;
+		}
+
+		return true;
+	}
+
+	inline offer_memo parse_offer(std::string_view args, uint8_t price_precision) {
+		offer_memo result;
+
+		size_t separator = args.find(':');
+		check(parse_amount(args.substr(0, separator), price_precision, result.price), "deposit: Offer memo has an invalid price");
+
+		while (separator != std::string_view::npos) {
+			args = args.substr(separator + 1);
+			separator = args.find(':');
+			std::string_view field = args.substr(0, separator);
+
+			if (field == "w") {
+				result.withdraw = true;
+			} else {
+				check(is_symbol_code(field) && result.token == symbol_code(), "deposit: Offer memo has an invalid token");
+				result.token = symbol_code(field);
+			}
+		}
+
+		return result;
+	}
+
+	// splits the memo in place, the returned views point into memo
+	inline deposit_memo parse_deposit(std::string_view memo) {
+		deposit_memo result;
+
+		size_t separator = memo.find(':');
+		std::string_view dao_part = memo.substr(0, separator);
+
+		check(parse_uint64(dao_part, result.dao_id), "deposit: Memo has to start with a valid dao_id");
+
+		if (separator == std::string_view::npos) {
+			return result;
+		}
+
+		std::string_view rest = memo.substr(separator + 1);
+		std::string_view keyword = rest.substr(0, rest.find(':'));
+
+		if (keyword == "offer") {
+			result.route = route_offer;
+			result.args = keyword.size() < rest.size() ? rest.substr(keyword.size() + 1) : std::string_view();
+			return result;
+		}
+
+		check(keyword.size() == rest.size() && is_name(rest), "deposit: Memo beneficiary is not a valid account name");
+		result.beneficiary = name(rest);
+
+		return result;
+	}
+}
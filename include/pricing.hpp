@@ -0,0 +1,45 @@
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+
+using namespace eosio;
+
+namespace pricing
+{
+	// price_per_unit is the amount of system token paid for one whole daos token,
+	// so every quantity is scaled down by 10^precision of the daos token
+	inline uint64_t unit(const symbol & token_symbol) {
+		uint64_t result = 1;
+		for (uint8_t i = 0; i < token_symbol.precision(); i++) {
+			result *= 10;
+		}
+		return result;
+	}
+
+	// cost of quantity at price_per_unit, the product is kept in 128 bits and
+	// rounded up so the payer never pays less than the quoted price
+	inline asset cost(const asset & quantity, const asset & price_per_unit) {
+		check(quantity.amount >= 0 && price_per_unit.amount >= 0, "pricing: negative quantity or price");
+
+		uint128_t product = uint128_t(quantity.amount) * uint128_t(price_per_unit.amount);
+		uint128_t token_unit = unit(quantity.symbol);
+		uint128_t amount = product / token_unit + (product % token_unit > 0 ? 1 : 0);
+
+		check(amount <= uint128_t(asset::max_amount), "pricing: cost is out of range");
+
+		return asset(int64_t(amount), price_per_unit.symbol);
+	}
+
+	// largest quantity of token_symbol that funds can pay for at price_per_unit,
+	// rounded down so cost(quantity(funds)) never exceeds funds
+	inline asset quantity(const asset & funds, const asset & price_per_unit, const symbol & token_symbol) {
+		check(funds.amount >= 0 && price_per_unit.amount > 0, "pricing: invalid funds or price");
+
+		uint128_t amount = uint128_t(funds.amount) * uint128_t(unit(token_symbol)) / uint128_t(price_per_unit.amount);
+
+		check(amount <= uint128_t(asset::max_amount), "pricing: quantity is out of range");
+
+		return asset(int64_t(amount), token_symbol);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+
+#include <document_graph/content.hpp>
+
+namespace hypha
+{
+    // Opt-in compression for long string contents. Documents are always
+    // hashed over the plain strings; only the stored row holds the compressed
+    // form, so hashes do not depend on whether compression was on.
+    namespace string_codec
+    {
+        // every compressed string starts with this marker, plain strings may not
+        inline const std::string MARKER{"\0lz1", 4};
+
+        bool isCompressed(std::string_view value);
+
+        // deterministic LZ77 encoding: a control byte below 0x80 is followed by
+        // that many plus one literal bytes, a control byte c >= 0x80 copies
+        // (c & 0x7F) + 4 bytes from a 16 bit little endian distance behind
+        std::string compress(std::string_view value);
+        std::string expand(std::string_view value);
+
+        // in place over a group, strings shorter than minLength are kept as
+        // they are and 0 turns compression off; strings are only replaced when
+        // compression makes them shorter, returns true when one was replaced
+        bool compressGroup(ContentGroup &contentGroup, uint32_t minLength);
+        void expandGroup(ContentGroup &contentGroup);
+
+        bool compressGroups(ContentGroups &contentGroups, uint32_t minLength);
+        void expandGroups(ContentGroups &contentGroups);
+
+        // Document rows are written plain, this rewrites the stored row of
+        // hash with its strings compressed when that makes any of them shorter
+        void compressDocument(const eosio::name &contract, const eosio::checksum256 &hash, uint32_t minLength);
+
+        // rejects plain strings that would be read back as compressed
+        void checkPlain(const ContentGroups &contentGroups);
+
+    } // namespace string_codec
+
+} // namespace hypha
@@ -0,0 +1,31 @@
+#include <eosio/eosio.hpp>
+#include <eosio/crypto.hpp>
+#include <util.hpp>
+
+using eosio::name;
+using std::string;
+
+// fiat_currency and time_zone are copied from the user row so the
+// (fiat_currency, method, time_zone) lookup is a single range scan
+#define DEFINE_PAYMENT_METHODS_TABLE TABLE payment_method_table { \
+      uint64_t id; \
+      name account; \
+      name method; \
+      name fiat_currency; \
+      name time_zone; \
+      string details; \
+\
+      uint64_t primary_key () const { return id; } \
+      uint128_t by_account_method () const { return (uint128_t(account.value) << 64) + method.value; } \
+      eosio::checksum256 by_currency_method_zone () const { \
+        return eosio::checksum256::make_from_word_sequence<uint64_t>(fiat_currency.value, method.value, time_zone.value, account.value); \
+      } \
+    }; \
+\
+    typedef eosio::multi_index<"paymethods"_n, payment_method_table, \
+      indexed_by<"byacctmethod"_n, \
+      const_mem_fun<payment_method_table, uint128_t, &payment_method_table::by_account_method>>, \
+      indexed_by<"bycurmethzn"_n, \
+      const_mem_fun<payment_method_table, eosio::checksum256, &payment_method_table::by_currency_method_zone>> \
+    > payment_method_tables;
+
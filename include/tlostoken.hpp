@@ -20,6 +20,13 @@
     CONTRACT tlostoken : public contract
     {
     public:
+        struct transfer_entry
+        {
+            name to;
+            asset quantity;
+            string memo;
+        };
+
         using contract::contract;
         tlostoken(name receiver, name code, datastream<const char*> ds)
         : contract (receiver, code, ds)
@@ -69,6 +76,23 @@
                                         const name &to,
                                         const asset &quantity,
                                         const string &memo);
+        /**
+          * Allows `from` account to transfer tokens to many accounts in one action.
+          * The token stats are read once and `from` is debited once for the total,
+          * then every `to` account is credited and notified.
+          *
+          * Recipients are notified with the `transfermany` payload, not with a
+          * `transfer` per entry. Contracts that only listen to `transfer` do not
+          * see these tokens arrive and need their own `transfermany` handler.
+          *
+          * @param from - the account to transfer from,
+          * @param transfers - the recipients, each with its quantity and memo.
+          *
+          * @pre All quantities must have the same symbol.
+          */
+        [[eosio::action]] void transfermany(const name &from,
+                                            const std::vector<transfer_entry> &transfers);
+
         /**
           * Allows `ram_payer` to create an account `owner` with zero balance for
           * token `symbol` at the expense of `ram_payer`.
@@ -112,6 +136,7 @@
         using issue_action = eosio::action_wrapper<"issue"_n, &tlostoken::issue>;
         using retire_action = eosio::action_wrapper<"retire"_n, &tlostoken::retire>;
         using transfer_action = eosio::action_wrapper<"transfer"_n, &tlostoken::transfer>;
+        using transfermany_action = eosio::action_wrapper<"transfermany"_n, &tlostoken::transfermany>;
         using open_action = eosio::action_wrapper<"open"_n, &tlostoken::open>;
         using close_action = eosio::action_wrapper<"close"_n, &tlostoken::close>;
 
@@ -4,6 +4,7 @@
 #include <eosio/asset.hpp>
 #include <contracts.hpp>
 #include <variant>
+#include <array>
 
 using namespace eosio;
 using std::string;
@@ -14,7 +15,37 @@ namespace util
 	const uint8_t type_sell_offer = 0;
 	const uint8_t type_buy_offer = 1;
 
+	// market orders, swept against the book up to a worst price and never stored
+	const uint8_t type_ioc_sell = 2; // immediate or cancel, the unfilled part is dropped
+	const uint8_t type_ioc_buy = 3;
+	const uint8_t type_fok_sell = 4; // fill or kill, fails unless all of it is filled
+	const uint8_t type_fok_buy = 5;
+
 	const uint8_t status_closed = 0;
 	const uint8_t status_active = 1;
 
+	// edges of a dao info node removed per daoinf::deldao call, it reschedules itself for the rest
+	const uint64_t max_info_edges = 50;
+
+	// rows ingested by a single daoinf::bulkload
+	const uint64_t max_bulk_rows = 100;
+
+	// offers matched by a single action at most
+	const uint8_t max_offer_matches = 20;
+
+	// candles table: {interval in seconds, ring buffer slots}
+	const std::array<std::pair<uint32_t, uint32_t>, 3> candle_intervals = {{
+		{60, 1440},   // 1m candles for the last day
+		{3600, 720},  // 1h candles for the last 30 days
+		{86400, 365}  // 1d candles for the last year
+	}};
+
+	// trades table, escrowed fiat trades
+	const uint8_t trade_status_open = 0;
+	const uint8_t trade_status_paid = 1;
+	const uint8_t trade_status_disputed = 2;
+
+	// default seconds the buyer has to confirm the fiat payment before the seller can cancel
+	const uint32_t trade_payment_window = 86400;
+
 }
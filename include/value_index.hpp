@@ -0,0 +1,96 @@
+#pragma once
+
+#include <eosio/crypto.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+
+#include <string>
+#include <vector>
+
+#include <document_graph/content.hpp>
+#include <document_graph/document.hpp>
+
+namespace hypha
+{
+    // contents that get indexed by value, nothing is indexed while this is empty
+    struct [[eosio::table]] IndexedField
+    {
+        uint64_t id;
+        std::string group_label;
+        std::string content_label;
+
+        uint64_t primary_key() const { return id; }
+
+        EOSLIB_SERIALIZE(IndexedField, (id)(group_label)(content_label))
+    };
+
+    typedef eosio::multi_index<eosio::name("idxfields"), IndexedField> indexed_field_table;
+
+    struct [[eosio::table]] ValueEntry
+    {
+        uint64_t id;
+        uint64_t field_id;
+        eosio::checksum256 value_hash;
+        eosio::checksum256 document_hash;
+
+        uint64_t primary_key() const { return id; }
+
+        // (field, value, document) so one field and value is a single range
+        eosio::checksum256 by_field_value() const
+        {
+            auto value = value_hash.extract_as_byte_array();
+            auto document = document_hash.extract_as_byte_array();
+            return eosio::checksum256::make_from_word_sequence<uint64_t>(
+                field_id, leadingWord(value.data()), leadingWord(document.data()), leadingWord(document.data() + 8));
+        }
+
+        eosio::checksum256 by_document() const { return document_hash; }
+
+        static uint64_t leadingWord(const uint8_t *bytes)
+        {
+            uint64_t word = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                word = (word << 8) | bytes[i];
+            }
+            return word;
+        }
+
+        EOSLIB_SERIALIZE(ValueEntry, (id)(field_id)(value_hash)(document_hash))
+    };
+
+    typedef eosio::multi_index<eosio::name("valueindex"), ValueEntry,
+        eosio::indexed_by<eosio::name("byfieldval"),
+        eosio::const_mem_fun<ValueEntry, eosio::checksum256, &ValueEntry::by_field_value>>,
+        eosio::indexed_by<eosio::name("bydocument"),
+        eosio::const_mem_fun<ValueEntry, eosio::checksum256, &ValueEntry::by_document>>
+    > value_entry_table;
+
+    // Maps (group label, content label, value) to the documents holding it
+    // for the declared fields. Document::emplace indexes new documents and
+    // DocumentGraph::eraseDocument removes them.
+    class ValueIndex
+    {
+    public:
+        ValueIndex(const eosio::name &contract);
+
+        // returns false when the field was already in that state
+        bool declare(const std::string &groupLabel, const std::string &contentLabel);
+        bool undeclare(const std::string &groupLabel, const std::string &contentLabel);
+
+        void index(const eosio::checksum256 &documentHash, const ContentGroups &contentGroups);
+        void unindex(const eosio::checksum256 &documentHash);
+
+        // documents holding value, at most limit of them
+        std::vector<eosio::checksum256> find(const std::string &groupLabel,
+                                             const std::string &contentLabel,
+                                             const Content::FlexValue &value,
+                                             uint32_t limit);
+
+        static eosio::checksum256 hashValue(const std::string &contentLabel, const Content::FlexValue &value);
+
+    private:
+        eosio::name m_contract;
+    };
+
+} // namespace hypha
@@ -4,6 +4,7 @@ const { createAccount, deployContract } = require('./deploy')
 const { accountExists, contractRunningSameCode } = require('./eosio-errors')
 const { setParamsValue } = require('./contract-settings')
 const { updatePermissions } = require('./permissions')
+const { exportSnapshot, importSnapshot } = require('./snapshot')
 const prompt = require('prompt-sync')()
 
 
@@ -156,6 +157,16 @@ async function main () {
       }
       break;
 
+    case 'snapshot':
+      if (args[1] == 'export') {
+        await exportSnapshot(args[2])
+
+      } else if (args[1] == 'import') {
+        await importSnapshot(args[2])
+
+      }
+      break;
+
     default:
       console.log('Invalid input.')
   } 
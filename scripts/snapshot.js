@@ -0,0 +1,217 @@
+const fs = require('fs')
+const crypto = require('crypto')
+const { rpc, transact } = require('./eos')
+const { contractNames } = require('./config')
+
+// Binary snapshot of the daoinf graph, version 2:
+//
+//   magic "DGSNAP", u16 version, string account
+//   per table: u8 1, string table, then per row: u32 size, row bytes,
+//   and a u32 0 after the last row of the table
+//   u8 0 after the last table
+//   sha256 of every byte before it
+//
+// strings are a u16 size plus utf8 bytes, integers are little endian. Rows
+// are kept exactly as the chain serializes them and bulkload receives those
+// bytes unchanged, so hashes, edge indexes and compressed strings are loaded
+// back without being decoded or recomputed. Tables are read in a single pass,
+// the end marker stands in for a row count taken up front.
+
+const MAGIC = Buffer.from('DGSNAP')
+const VERSION = 2
+const HASH_SIZE = 32
+
+const TABLES = ['documents', 'edges', 'daoindex']
+
+// rows and serialized bytes sent in one bulkload action
+const MAX_ROWS_PER_ACTION = 100
+const MAX_BYTES_PER_ACTION = 256 * 1024
+
+const encodeString = (value) => {
+  const bytes = Buffer.from(value, 'utf8')
+  const size = Buffer.alloc(2)
+  size.writeUInt16LE(bytes.length)
+  return Buffer.concat([size, bytes])
+}
+
+const encodeUInt = (value, size) => {
+  const buf = Buffer.alloc(size)
+  size === 1 ? buf.writeUInt8(value) : size === 2 ? buf.writeUInt16LE(value) : buf.writeUInt32LE(value)
+  return buf
+}
+
+class SnapshotWriter {
+
+  constructor (path) {
+    this.stream = fs.createWriteStream(path)
+    this.hash = crypto.createHash('sha256')
+  }
+
+  async write (buf) {
+    this.hash.update(buf)
+    if (!this.stream.write(buf)) {
+      await new Promise(resolve => this.stream.once('drain', resolve))
+    }
+  }
+
+  async close () {
+    const digest = this.hash.digest()
+    this.stream.end(digest)
+    await new Promise((resolve, reject) => {
+      this.stream.once('finish', resolve)
+      this.stream.once('error', reject)
+    })
+    return digest.toString('hex')
+  }
+
+}
+
+// pulls exact byte counts out of a file stream without loading the file
+class SnapshotReader {
+
+  constructor (path) {
+    this.iterator = fs.createReadStream(path)[Symbol.asyncIterator]()
+    this.buffer = Buffer.alloc(0)
+  }
+
+  async read (size) {
+    while (this.buffer.length < size) {
+      const { value, done } = await this.iterator.next()
+      if (done) throw new Error('snapshot is truncated')
+      this.buffer = Buffer.concat([this.buffer, value])
+    }
+    const chunk = this.buffer.subarray(0, size)
+    this.buffer = this.buffer.subarray(size)
+    return chunk
+  }
+
+  async readUInt (size) {
+    const buf = await this.read(size)
+    return size === 1 ? buf.readUInt8() : size === 2 ? buf.readUInt16LE() : buf.readUInt32LE()
+  }
+
+  async readString () {
+    return (await this.read(await this.readUInt(2))).toString('utf8')
+  }
+
+}
+
+async function verifySnapshot (path) {
+  const { size } = await fs.promises.stat(path)
+  if (size < MAGIC.length + HASH_SIZE) throw new Error('snapshot is truncated')
+
+  const hash = crypto.createHash('sha256')
+  for await (const chunk of fs.createReadStream(path, { end: size - HASH_SIZE - 1 })) {
+    hash.update(chunk)
+  }
+
+  const expected = Buffer.alloc(HASH_SIZE)
+  const file = await fs.promises.open(path, 'r')
+  await file.read(expected, 0, HASH_SIZE, size - HASH_SIZE)
+  await file.close()
+
+  if (!hash.digest().equals(expected)) throw new Error('snapshot checksum does not match')
+}
+
+async function * getRawRows (account, table) {
+  let lowerBound = ''
+  while (true) {
+    const res = await rpc.get_table_rows({
+      code: account,
+      scope: account,
+      table,
+      json: false,
+      lower_bound: lowerBound,
+      limit: 500
+    })
+    for (const row of res.rows) {
+      yield Buffer.from(row, 'hex')
+    }
+    if (!res.more) return
+    lowerBound = res.next_key
+  }
+}
+
+async function exportSnapshot (path, account = contractNames.daoinf) {
+  const groups = await rpc.get_table_rows({ code: account, scope: account, table: 'groups', json: true, limit: 1 })
+  if (groups.rows.length > 0) {
+    throw new Error('stored groups are not part of snapshots, export before turning dedup_groups on')
+  }
+
+  const writer = new SnapshotWriter(path)
+  await writer.write(Buffer.concat([MAGIC, encodeUInt(VERSION, 2), encodeString(account)]))
+
+  for (const table of TABLES) {
+    await writer.write(Buffer.concat([encodeUInt(1, 1), encodeString(table)]))
+
+    let count = 0
+    for await (const row of getRawRows(account, table)) {
+      await writer.write(Buffer.concat([encodeUInt(row.length, 4), row]))
+      count++
+    }
+
+    // rows are never empty, a zero size ends the table
+    await writer.write(encodeUInt(0, 4))
+    console.log(`${table}: ${count} rows`)
+  }
+
+  await writer.write(encodeUInt(0, 1))
+  const digest = await writer.close()
+  console.log('sha256:', digest)
+}
+
+async function importSnapshot (path, account = contractNames.daoinf) {
+  await verifySnapshot(path)
+
+  const reader = new SnapshotReader(path)
+
+  if (!(await reader.read(MAGIC.length)).equals(MAGIC)) throw new Error('not a graph snapshot')
+
+  const version = await reader.readUInt(2)
+  if (version !== VERSION) throw new Error(`unsupported snapshot version ${version}`)
+
+  const source = await reader.readString()
+  if (source !== account) {
+    throw new Error(`snapshot of ${source} can not be loaded into ${account}, node hashes cover the owner account`)
+  }
+
+  // rows travel as hex so their bytes reach the contract untouched
+  const sendChunk = async (table, rows) => {
+    await transact({
+      actions: [{
+        account,
+        name: 'bulkload',
+        authorization: [{ actor: account, permission: 'active' }],
+        data: { table, rows: rows.map(row => row.toString('hex')) }
+      }]
+    })
+  }
+
+  while (await reader.readUInt(1) === 1) {
+    const table = await reader.readString()
+    if (!TABLES.includes(table)) throw new Error(`unknown table ${table} in snapshot`)
+
+    let count = 0
+    let chunk = []
+    let chunkBytes = 0
+
+    for (let size = await reader.readUInt(4); size > 0; size = await reader.readUInt(4)) {
+      const row = await reader.read(size)
+
+      if (chunk.length === MAX_ROWS_PER_ACTION || chunkBytes + row.length > MAX_BYTES_PER_ACTION) {
+        await sendChunk(table, chunk)
+        chunk = []
+        chunkBytes = 0
+      }
+
+      chunk.push(row)
+      chunkBytes += row.length
+      count++
+    }
+
+    if (chunk.length > 0) await sendChunk(table, chunk)
+    console.log(`${table}: ${count} rows`)
+  }
+}
+
+module.exports = { exportSnapshot, importSnapshot, verifySnapshot }
@@ -1,11 +1,16 @@
 #include <daoinf.hpp>
 
 #include "document_graph/content.cpp"
+#include "document_graph/string_codec.cpp"
 #include "document_graph/document.cpp"
 #include "document_graph/edge.cpp"
 #include "document_graph/util.cpp"
 #include "document_graph/content_wrapper.cpp"
 #include "document_graph/document_graph.cpp"
+#include "document_graph/traversal.cpp"
+#include "document_graph/edge_writer.cpp"
+#include "document_graph/group_store.cpp"
+#include "document_graph/value_index.cpp"
 
 ACTION daoinf::reset () {
   require_auth(get_self());
@@ -22,6 +27,36 @@ ACTION daoinf::reset () {
     eitr = e_t.erase(eitr);
   }
 
+  hypha::group_table g_t(_self, get_self().value);
+  auto gitr = g_t.begin();
+  while (gitr != g_t.end()) {
+    gitr = g_t.erase(gitr);
+  }
+
+  hypha::group_refs_table r_t(_self, get_self().value);
+  auto ritr = r_t.begin();
+  while (ritr != r_t.end()) {
+    ritr = r_t.erase(ritr);
+  }
+
+  dao_index_table index_t(_self, get_self().value);
+  auto iitr = index_t.begin();
+  while (iitr != index_t.end()) {
+    iitr = index_t.erase(iitr);
+  }
+
+  hypha::value_entry_table v_t(_self, get_self().value);
+  auto vitr = v_t.begin();
+  while (vitr != v_t.end()) {
+    vitr = v_t.erase(vitr);
+  }
+
+  hypha::indexed_field_table f_t(_self, get_self().value);
+  auto fitr = f_t.begin();
+  while (fitr != f_t.end()) {
+    fitr = f_t.erase(fitr);
+  }
+
   // creates the root node
   hypha::ContentGroups root_cgs {
     hypha::ContentGroup {
@@ -47,13 +82,31 @@ ACTION daoinf::reset () {
 
 }
 
+ACTION daoinf::setgraphcfg(const bool & dedup_groups, const uint32_t & compress_min_length) {
+  require_auth(get_self());
+
+  check(
+    compress_min_length == 0 || compress_min_length > hypha::string_codec::MARKER.size(), 
+    "compress min length is too small"
+  );
+
+  graph_config config = graph_params.get();
+  config.dedup_groups = dedup_groups;
+  config.compress_min_length = compress_min_length;
+  graph_params.set(config, get_self());
+}
+
 ACTION daoinf::adddao(const name & creator, const uint64_t & dao_id) {
-  require_auth( has_auth(creator) ? creator : get_self() );
+  if (!has_auth(contracts::daoreg)) {
+    require_auth( has_auth(creator) ? creator : get_self() );
+  }
 
   check(dao_id > 0, "dao id must be greater than zero");
 
   // get root or get daos node
-  hypha::Document daos_doc = get_dao_node();
+  checksum256 daos_hash = get_daos_hash();
+
+  check(!edge_exists(daos_hash, name(dao_id)), "dao info node already exists");
 
 
   // creates the dao info node
@@ -61,6 +114,7 @@ ACTION daoinf::adddao(const name & creator, const uint64_t & dao_id) {
     hypha::ContentGroup {
       hypha::Content(hypha::CONTENT_GROUP_LABEL, FIXED_DETAILS),
       hypha::Content(CREATOR, creator),
+      hypha::Content(DAO_ID, int64_t(dao_id)),
       hypha::Content(OWNER, get_self())
     },
     hypha::ContentGroup {
@@ -69,44 +123,152 @@ ACTION daoinf::adddao(const name & creator, const uint64_t & dao_id) {
     }
   };
 
-  // static void write(const eosio::name &_contract,
-  //                        const eosio::name &_creator,
-  //                        const eosio::checksum256 &_from_node,
-  //                        const eosio::checksum256 &_to_node,
-  //                        const eosio::name &_edge_name);
+  graph::dao_info_view(dao_info_cgs).validate();
+
+  const graph_config & config = graph_params.get();
+
+  if (config.dedup_groups) {
+    dao_info_cgs = m_groupStore.store(dao_info_cgs, config.compress_min_length);
+  }
+
   hypha::Document dao_info_doc(get_self(), get_self(), std::move(dao_info_cgs));
+  hypha::string_codec::compressDocument(get_self(), dao_info_doc.getHash(), config.compress_min_length);
+
+  hypha::writeEdges(get_self(), get_self(), {
+    hypha::EdgeSpec{daos_hash, dao_info_doc.getHash(), name(dao_id)},
+    hypha::EdgeSpec{daos_hash, dao_info_doc.getHash(), graph::DAOS}
+  });
 
-  hypha::Edge::write(get_self(), get_self(), daos_doc.getHash(), dao_info_doc.getHash(), name(dao_id));
-  hypha::Edge::write(get_self(), get_self(), daos_doc.getHash(), dao_info_doc.getHash(), graph::DAOS);
-  
+  index_dao(dao_id, dao_info_doc.getHash(), dao_info_doc.getCreated());
 
 }
 
+ACTION daoinf::deldao(const uint64_t & dao_id, const uint64_t & max_edges) {
+  require_auth( has_auth(contracts::daoreg) ? contracts::daoreg : get_self() );
+
+  check(max_edges > 0, "max edges must be greater than zero");
+
+  checksum256 daos_hash = get_daos_hash();
+
+  std::vector<hypha::Edge> dao_edges = m_documentGraph.getEdgesFrom(daos_hash, name(dao_id));
+  if (dao_edges.size() == 0) return;
+
+  checksum256 info_hash = dao_edges[0].getToNode();
+
+  // the name(dao_id) edge goes last, it is how the next call finds the node again
+  auto is_lookup_edge = [&](const auto & edge) {
+    return edge.from_node == daos_hash && edge.edge_name == name(dao_id);
+  };
+
+  edge_table e_t(get_self(), get_self().value);
+  uint64_t removed = 0;
+
+  auto from_node_index = e_t.get_index<name("fromnode")>();
+  auto from_itr = from_node_index.find(info_hash);
+
+  while (from_itr != from_node_index.end() && from_itr->from_node == info_hash && removed < max_edges) {
+    from_itr = from_node_index.erase(from_itr);
+    removed++;
+  }
+
+  auto to_node_index = e_t.get_index<name("tonode")>();
+  auto to_itr = to_node_index.find(info_hash);
+
+  while (to_itr != to_node_index.end() && to_itr->to_node == info_hash && removed < max_edges) {
+    if (is_lookup_edge(*to_itr)) {
+      to_itr++;
+      continue;
+    }
+    to_itr = to_node_index.erase(to_itr);
+    removed++;
+  }
+
+  // the lookup edge is still there, the next chunk runs as a new action so
+  // each call stays within max_edges
+  if (removed == max_edges) {
+    action(
+      permission_level(get_self(), name("active")),
+      get_self(),
+      name("deldao"),
+      std::make_tuple(dao_id, max_edges)
+    ).send();
+    return;
+  }
+
+  document_table d_t(get_self(), get_self().value);
+  auto hash_index = d_t.get_index<name("idhash")>();
+  auto ditr = hash_index.find(info_hash);
+  if (ditr != hash_index.end()) {
+    m_groupStore.release(ditr -> getContentGroups());
+  }
+
+  m_documentGraph.eraseDocument(info_hash, true);
+
+  dao_index_table index_t(get_self(), get_self().value);
+  auto iitr = index_t.find(dao_id);
+  if (iitr != index_t.end()) {
+    index_t.erase(iitr);
+  }
+}
+
 ACTION daoinf::storeentry(const std::vector<hypha::Content> & values, const uint64_t &dao_id) {
   hypha::Document dao_doc = get_dao_inf_node(dao_id);
-  hypha::Document * node_doc = &dao_doc;
+  hypha::ContentGroups stored_groups = expand_node(dao_doc);
 
-  hypha::ContentWrapper dao_cw = dao_doc.getContentWrapper();
-
-  name creator = dao_cw.getOrFail(FIXED_DETAILS, CREATOR) -> getAs<name>();
+  name creator = graph::dao_info_view(dao_doc.getContentGroups()).get<graph::dao_info_schema::creator>();
 
   name auth = has_auth(creator) ? creator : get_self();
   require_auth(auth);
 
-  update_node(&dao_doc, VARIABLE_DETAILS, values);
+  check_contents(values);
+
+  update_node(&dao_doc, stored_groups, dao_id, VARIABLE_DETAILS, values);
+}
+
+ACTION daoinf::storeentries(const std::vector<dao_entry> & entries) {
+  check(entries.size() > 0, "no entries to store");
+
+  // group the entries per dao so each info node is hashed and re-linked once
+  std::map<uint64_t, std::vector<const dao_entry *>> entries_by_dao;
+  for (const auto & entry : entries) {
+    check(entry.group_label != FIXED_DETAILS, "Cannot modify the fixed details content");
+    check_contents(entry.contents);
+    entries_by_dao[entry.dao_id].push_back(&entry);
+  }
+
+  for (const auto & [dao_id, dao_entries] : entries_by_dao) {
+    hypha::Document dao_doc(get_self(), get_dao_inf_hash(dao_id));
+    hypha::ContentGroups stored_groups = expand_node(dao_doc);
+
+    name creator = graph::dao_info_view(dao_doc.getContentGroups()).get<graph::dao_info_schema::creator>();
+    require_auth( has_auth(creator) ? creator : get_self() );
+
+    hypha::ContentWrapper dao_cw = dao_doc.getContentWrapper();
+
+    bool changed = false;
+    for (const dao_entry * entry : dao_entries) {
+      hypha::ContentGroup * node_cg = dao_cw.getGroupOrCreate(entry -> group_label).second;
+      changed |= merge_contents(*node_cg, entry -> contents);
+    }
+
+    // an unchanged node would hash to itself, there is nothing to rewrite
+    if (changed) {
+      write_node(dao_doc, stored_groups, dao_id);
+    }
+  }
 }
 
 ACTION daoinf::delentry(const std::vector<string> & labels, const uint64_t &dao_id) {
   hypha::Document dao_doc = get_dao_inf_node(dao_id);
-  hypha::Document * node_doc = &dao_doc;
-
-  hypha::ContentWrapper dao_cw = dao_doc.getContentWrapper();
+  hypha::ContentGroups stored_groups = expand_node(dao_doc);
 
-  name creator = dao_cw.getOrFail(FIXED_DETAILS, CREATOR) -> getAs<name>();
+  name creator = graph::dao_info_view(dao_doc.getContentGroups()).get<graph::dao_info_schema::creator>();
 
   name auth = has_auth(creator) ? creator : get_self();
   require_auth(auth);
 
+  hypha::ContentWrapper dao_cw = dao_doc.getContentWrapper();
+
   for (int i = 0; i < labels.size(); i++) {
     if (labels[i] != VARIABLE_DETAILS) {
       dao_cw.removeContent(VARIABLE_DETAILS, labels[i]);
@@ -115,12 +277,196 @@ ACTION daoinf::delentry(const std::vector<string> & labels, const uint64_t &dao_
     }
   }
 
-  m_documentGraph.updateDocument(get_self(), node_doc -> getHash(), node_doc -> getContentGroups());
+  write_node(dao_doc, stored_groups, dao_id);
 }
 
-void daoinf::update_node (hypha::Document * node_doc, const string & content_group_label, const std::vector<hypha::Content> & new_contents) {
-  checksum256 old_node_hash = node_doc -> getHash();
+ACTION daoinf::listdaos(const uint64_t & cursor, const uint32_t & limit, const bool & by_created) {
+  check(limit > 0 && limit <= 100, "limit must be between 1 and 100");
+
+  dao_index_table index_t(get_self(), get_self().value);
+
+  std::string page = "{\"rows\":[";
+  uint64_t next_cursor = 0;
+  uint32_t count = 0;
+
+  auto print_rows = [&](auto & index, auto itr) {
+    for (; itr != index.end(); itr++) {
+      if (count == limit) {
+        next_cursor = itr -> dao_id;
+        break;
+      }
+      if (count > 0) page += ",";
+      page += "{\"dao_id\":" + std::to_string(itr -> dao_id) +
+              ",\"info_hash\":\"" + hypha::readableHash(itr -> info_hash) +
+              "\",\"created_date\":" + std::to_string(itr -> created_date.sec_since_epoch()) + "}";
+      count++;
+    }
+  };
+
+  // the cursor is the dao_id of the first row of the page in both orders
+  if (by_created) {
+    auto index_by_created = index_t.get_index<name("bycreated")>();
+    auto start = index_by_created.begin();
+    if (cursor > 0) {
+      auto citr = index_t.find(cursor);
+      check(citr != index_t.end(), "cursor not found");
+      start = index_by_created.lower_bound(citr -> by_created());
+    }
+    print_rows(index_by_created, start);
+  } else {
+    print_rows(index_t, index_t.lower_bound(cursor));
+  }
+
+  page += "],\"next_cursor\":" + std::to_string(next_cursor) + "}";
+  print(page);
+}
+
+// dao ids are handed out in order by daoreg, ids without a node are skipped
+ACTION daoinf::indexdaos(const uint64_t & start_dao_id, const uint64_t & max_daos) {
+  require_auth(get_self());
+
+  check(max_daos > 0, "max daos must be greater than zero");
+
+  checksum256 daos_hash = get_daos_hash();
+  dao_index_table index_t(get_self(), get_self().value);
+
+  uint64_t dao_id = std::max(start_dao_id, uint64_t(1));
+  uint64_t end_dao_id = dao_id + max_daos;
 
+  for (; dao_id < end_dao_id; dao_id++) {
+    if (index_t.find(dao_id) != index_t.end()) continue;
+
+    std::vector<hypha::Edge> dao_edges = m_documentGraph.getEdgesFrom(daos_hash, name(dao_id));
+    if (dao_edges.size() == 0) continue;
+
+    // a node that was never updated still carries the time it was created
+    hypha::Document info_doc(get_self(), dao_edges[0].getToNode());
+    index_dao(dao_id, info_doc.getHash(), info_doc.getCreated());
+  }
+
+  print("{\"next_dao_id\":" + std::to_string(dao_id) + "}");
+}
+
+ACTION daoinf::setindexed(const string & group_label, const string & content_label, const bool & indexed) {
+  require_auth(get_self());
+
+  hypha::ValueIndex value_index(get_self());
+
+  if (indexed) {
+    check(value_index.declare(group_label, content_label), "field is already indexed");
+  } else {
+    check(value_index.undeclare(group_label, content_label), "field is not indexed");
+  }
+}
+
+ACTION daoinf::finddocs(const string & group_label, const hypha::Content & content, const uint32_t & limit) {
+  check(limit > 0 && limit <= 100, "limit must be between 1 and 100");
+
+  std::vector<checksum256> documents = hypha::ValueIndex(get_self()).find(group_label, content.label, content.value, limit);
+
+  std::string page = "{\"documents\":[";
+  for (int i = 0; i < documents.size(); i++) {
+    if (i > 0) page += ",";
+    page += "\"" + hypha::readableHash(documents[i]) + "\"";
+  }
+  page += "]}";
+  print(page);
+}
+
+// Rows are written as the snapshot stored them: hashes, edge index values
+// and compressed strings are not recomputed. Rows already present are
+// skipped, so a chunk can be sent again after a failed transaction. The
+// snapshot has to come from an account with the same name, the hashes of
+// the root and daos nodes cover their owner.
+// rows arrive packed as the chain stored them, unpacking them here keeps the
+// bytes of compressed strings that a json round trip would not preserve.
+// Rows already in the graph are skipped, a row whose key is taken by a
+// different row rejects the whole load instead of failing on the emplace
+ACTION daoinf::bulkload(const name & table, const std::vector<std::vector<char>> & rows) {
+  require_auth(get_self());
+
+  check(
+    rows.size() <= util::max_bulk_rows,
+    "too many rows, at most " + std::to_string(util::max_bulk_rows) + " per action"
+  );
+
+  if (table == name("documents")) {
+    load_documents(rows);
+  } else if (table == name("edges")) {
+    load_edges(rows);
+  } else if (table == name("daoindex")) {
+    load_index_rows(rows);
+  } else {
+    check(false, "unknown snapshot table " + table.to_string());
+  }
+}
+
+void daoinf::load_documents (const std::vector<std::vector<char>> & rows) {
+  document_table d_t(get_self(), get_self().value);
+  auto hash_index = d_t.get_index<name("idhash")>();
+  hypha::ValueIndex value_index(get_self());
+
+  for (const auto & row : rows) {
+    hypha::Document document = unpack<hypha::Document>(row);
+
+    if (hash_index.find(document.getHash()) != hash_index.end()) continue;
+
+    check(!hypha::GroupStore::hasReferences(document.getContentGroups()), "snapshots can not hold stored groups");
+    check(
+      d_t.find(document.primary_key()) == d_t.end(),
+      "document id " + std::to_string(document.primary_key()) + " is taken by another node, load snapshots into a graph reset to its root and daos nodes"
+    );
+
+    d_t.emplace(get_self(), [&](auto & d){
+      d = document;
+    });
+
+    hypha::ContentGroups plain = document.getContentGroups();
+    hypha::string_codec::expandGroups(plain);
+    value_index.index(document.getHash(), plain);
+  }
+}
+
+void daoinf::load_edges (const std::vector<std::vector<char>> & rows) {
+  edge_table e_t(get_self(), get_self().value);
+
+  for (const auto & row : rows) {
+    hypha::Edge edge = unpack<hypha::Edge>(row);
+
+    auto eitr = e_t.find(edge.id);
+    if (eitr != e_t.end()) {
+      check(
+        eitr -> from_node == edge.from_node && eitr -> to_node == edge.to_node && eitr -> edge_name == edge.edge_name,
+        "edge id " + std::to_string(edge.id) + " is taken by another edge"
+      );
+      continue;
+    }
+
+    e_t.emplace(get_self(), [&](auto & e){
+      e = edge;
+    });
+  }
+}
+
+void daoinf::load_index_rows (const std::vector<std::vector<char>> & rows) {
+  dao_index_table index_t(get_self(), get_self().value);
+
+  for (const auto & row : rows) {
+    daoindex index_row = unpack<daoindex>(row);
+
+    auto iitr = index_t.find(index_row.dao_id);
+    if (iitr != index_t.end()) {
+      check(iitr -> info_hash == index_row.info_hash, "dao " + std::to_string(index_row.dao_id) + " is already indexed with another info node");
+      continue;
+    }
+
+    index_t.emplace(get_self(), [&](auto & item){
+      item = index_row;
+    });
+  }
+}
+
+void daoinf::update_node (hypha::Document * node_doc, const hypha::ContentGroups & stored_groups, const uint64_t & dao_id, const string & content_group_label, const std::vector<hypha::Content> & new_contents) {
   hypha::ContentWrapper node_cw = node_doc -> getContentWrapper();
   hypha::ContentGroup * node_cg = node_cw.getGroupOrFail(content_group_label);
 
@@ -128,33 +474,127 @@ void daoinf::update_node (hypha::Document * node_doc, const string & content_gro
     hypha::ContentWrapper::insertOrReplace(*node_cg, new_contents[i]);
   }
 
-  m_documentGraph.updateDocument(get_self(), old_node_hash, node_doc -> getContentGroups());
+  write_node(*node_doc, stored_groups, dao_id);
+}
+
+// swaps stub groups for their stored copies and returns the stubs, which are
+// empty when the node was not written through the group store
+hypha::ContentGroups daoinf::expand_node (hypha::Document & node_doc) {
+  hypha::ContentGroups stored_groups;
+
+  if (hypha::GroupStore::hasReferences(node_doc.getContentGroups())) {
+    stored_groups = std::move(node_doc.getContentGroups());
+    node_doc.getContentGroups() = m_groupStore.expand(stored_groups);
+  }
+
+  return stored_groups;
+}
+
+// node_doc still carries the hash it was loaded with, its groups are moved out
+void daoinf::write_node (hypha::Document & node_doc, const hypha::ContentGroups & stored_groups, const uint64_t & dao_id) {
+  graph::dao_info_view(node_doc.getContentGroups()).validate();
+
+  // the groups are expanded at this point, a stub left here was not made by the group store
+  check(!hypha::GroupStore::hasReferences(node_doc.getContentGroups()), "dao info nodes can not hold group references");
+
+  const graph_config & config = graph_params.get();
+
+  hypha::Document new_doc = m_documentGraph.updateDocument(
+    get_self(),
+    node_doc.getHash(),
+    m_groupStore.replace(stored_groups, std::move(node_doc.getContentGroups()), config.dedup_groups, config.compress_min_length)
+  );
+  hypha::string_codec::compressDocument(get_self(), new_doc.getHash(), config.compress_min_length);
+
+  // node_doc is the stored node before this update
+  index_dao(dao_id, new_doc.getHash(), node_doc.getCreated());
+}
+
+// created_date is only used for new rows, nodes created before the index
+// existed get their row on their next update or through indexdaos
+void daoinf::index_dao (const uint64_t & dao_id, const checksum256 & info_hash, const time_point & created_date) {
+  dao_index_table index_t(get_self(), get_self().value);
+  auto iitr = index_t.find(dao_id);
+
+  if (iitr == index_t.end()) {
+    index_t.emplace(get_self(), [&](auto & item){
+      item.dao_id = dao_id;
+      item.info_hash = info_hash;
+      item.created_date = created_date;
+    });
+  } else {
+    index_t.modify(iitr, get_self(), [&](auto & item){
+      item.info_hash = info_hash;
+    });
+  }
+}
+
+// stubs are told apart by their group_ref content, user input may not forge one
+void daoinf::check_contents (const std::vector<hypha::Content> & contents) {
+  for (const auto & content : contents) {
+    check(content.label != hypha::GROUP_REF_LABEL, "content label " + hypha::GROUP_REF_LABEL + " is reserved");
+  }
+}
+
+bool daoinf::merge_contents (hypha::ContentGroup & content_group, const std::vector<hypha::Content> & new_contents) {
+  bool changed = false;
+
+  for (const auto & new_content : new_contents) {
+    auto content_itr = std::find_if(content_group.begin(), content_group.end(), [&](const auto & c) {
+      return c.label == new_content.label;
+    });
+
+    if (content_itr == content_group.end()) {
+      content_group.push_back(new_content);
+      changed = true;
+    } else if (content_itr -> value != new_content.value) {
+      content_itr -> value = new_content.value;
+      changed = true;
+    }
+  }
+
+  return changed;
 }
 
 hypha::Document daoinf::get_dao_inf_node(const uint64_t & dao_id) {
-  hypha::Document dao_node = get_dao_node();
-  return get_doc_from_edge(dao_node.getHash(), name(dao_id));
+  return hypha::Document(get_self(), get_dao_inf_hash(dao_id));
 }
 
-hypha::Document daoinf::get_dao_node () {
-  hypha::Document root_doc = get_root_node();
-  return get_doc_from_edge(root_doc.getHash(), graph::HAS_DAOS);
+// one row read through the index, nodes not indexed yet are found by walking
+// root -> daos -> info by hash
+checksum256 daoinf::get_dao_inf_hash(const uint64_t & dao_id) {
+  dao_index_table index_t(get_self(), get_self().value);
+  auto iitr = index_t.find(dao_id);
+
+  if (iitr != index_t.end()) {
+    return iitr -> info_hash;
+  }
+
+  return get_hash_from_edge(get_daos_hash(), name(dao_id));
 }
 
-hypha::Document daoinf::get_root_node () {
+checksum256 daoinf::get_daos_hash () {
+  return get_hash_from_edge(get_root_hash(), graph::HAS_DAOS);
+}
+
+checksum256 daoinf::get_root_hash () {
   document_table d_t(get_self(), get_self().value);
   auto root_itr = d_t.begin();
 
   check(root_itr != d_t.end(), "There is no root node");
 
-  hypha::Document root_doc(get_self(), root_itr -> getHash());
-  return root_doc;
+  return root_itr -> getHash();
 }
 
-hypha::Document daoinf::get_doc_from_edge (const checksum256 & node_hash, const name & edge_name) {
-  std::vector<hypha::Edge> edges = m_documentGraph.getEdgesFromOrFail(node_hash, edge_name);
-  hypha::Document node_to(get_self(), edges[0].getToNode());
-  return node_to;
+checksum256 daoinf::get_hash_from_edge (const checksum256 & node_hash, const name & edge_name) {
+  hypha::TraversalOptions options;
+  options.edgeNames = { edge_name };
+  options.maxVisits = 2;
+
+  std::vector<checksum256> hashes = m_graphTraversal.reachable(node_hash, options);
+  check(hashes.size() > 0, "no edges exist with name " + edge_name.to_string());
+
+  return hashes[0];
 }
 
 bool daoinf::edge_exists (const checksum256 & from_node_hash, const name & edge_name) {
@@ -34,37 +34,46 @@ ACTION daoreg::create(const name& dao, const name& creator, const std::string& i
 
   check(daoit == dao_by_id.end(), "dao with the same name already exists");
 
+  uint64_t dao_id = _dao.available_primary_key();
+  dao_id = dao_id > 0 ? dao_id : 1;
+
   _dao.emplace(get_self(), [&](auto& new_org){
-    uint64_t dao_id = _dao.available_primary_key();
-    dao_id = dao_id > 0 ? dao_id : 1;
     new_org.dao_id = dao_id;
     new_org.dao = dao;
     new_org.creator = creator;
     new_org.ipfs = ipfs;
   });
 
+  const settings & sttngs = params.get();
+
+  if (sttngs.info_account != name()) {
+    action(
+        permission_level(get_self(), name("active")),
+        sttngs.info_account,
+        name("adddao"),
+        std::make_tuple(creator, dao_id)
+    ).send();
+  }
+
   if (is_account(dao)) {
 
-    uint64_t ram_bytes = config_get_uint64(name("b.rambytes"));
+    require_params({ name("b.rambytes"), name("d.net"), name("d.cpu") });
 
-    if (ram_bytes > 0) {
+    if (sttngs.ram_bytes > 0) {
       action(
           permission_level(get_self(), name("active")),
           name("eosio"),
           name("buyrambytes"),
-          std::make_tuple(get_self(), dao, uint32_t(ram_bytes))
+          std::make_tuple(get_self(), dao, uint32_t(sttngs.ram_bytes))
       ).send();
     }
 
-    asset del_amount_net = config_get_asset(name("d.net"));
-    asset del_amount_cpu = config_get_asset(name("d.cpu"));
-
-    if ( del_amount_net.amount > 0 || del_amount_cpu.amount > 0 ) {
+    if ( sttngs.delegated_net.amount > 0 || sttngs.delegated_cpu.amount > 0 ) {
       action(
           permission_level(get_self(), name("active")),
           name("eosio"),
           name("delegatebw"),
-          std::make_tuple(get_self(), dao, del_amount_net, del_amount_cpu, true)
+          std::make_tuple(get_self(), dao, sttngs.delegated_net, sttngs.delegated_cpu, true)
       ).send();
     }
   }
@@ -94,11 +103,49 @@ ACTION daoreg::delorg(const uint64_t& dao_id) {
   auto daoit = _dao.find( dao_id );
   check( daoit != _dao.end(), "Organization not found" );
 
+  token_registry_table registry_t(get_self(), get_self().value);
+
+  for (auto& itr : daoit->tokens) {
+    auto ritr = registry_t.find(itr.first.value);
+    if (ritr == registry_t.end()) continue;
+
+    if (ritr->tokens > 1) {
+      registry_t.modify(ritr, get_self(), [&](auto& item){
+        item.tokens -= 1;
+      });
+    } else {
+      registry_t.erase(ritr);
+    }
+  }
+
+  tokens_table token_t(get_self(), dao_id);
+  auto titr = token_t.begin();
+  while (titr != token_t.end()) {
+    titr = token_t.erase(titr);
+  }
+
   _dao.erase(daoit);
+
+  // daoinf::deldao sends itself again until nodes with more edges than one chunk are gone
+  name info_account = params.get().info_account;
+  if (info_account != name()) {
+    action(
+        permission_level(get_self(), name("active")),
+        info_account,
+        name("deldao"),
+        std::make_tuple(dao_id, util::max_info_edges)
+    ).send();
+  }
 }
 
 ACTION daoreg::setparam(name key, VariantValue value, string description)
 {
+  require_auth(get_self());
+
+  settings sttngs = params.get();
+  apply_param(sttngs, key, value);
+  params.set(sttngs, get_self());
+
   auto citr = config.find(key.value);
   if (citr == config.end()) {
     config.emplace(_self, [&](auto & item){
@@ -125,6 +172,88 @@ ACTION daoreg::resetsttngs() {
   while (citr != config.end()) {
     citr = config.erase(citr);
   }
+
+  params.remove();
+}
+
+// settings read as zero until they are set, actions that should not run on
+// those defaults fail the way config_get did before the settings singleton
+void daoreg::require_params(std::initializer_list<name> keys) {
+  uint64_t initialized = params.get().initialized;
+
+  for (const name & key : keys) {
+    check(initialized & param_bit(key), "settings: the " + key.to_string() + " parameter has not been initialized");
+  }
+}
+
+// bit of settings::initialized for key, in the order keys were introduced
+uint64_t daoreg::param_bit(const name & key) {
+  static const name keys[] = {
+    name("b.rambytes"), name("d.net"), name("d.cpu"), name("log.account"),
+    name("info.account"), name("erase.empty"), name("trade.window")
+  };
+
+  for (uint8_t i = 0; i < std::size(keys); i++) {
+    if (keys[i] == key) return uint64_t(1) << i;
+  }
+
+  check(false, "setparam: unknown parameter");
+  return 0;
+}
+
+void daoreg::apply_param(settings & current, const name & key, const VariantValue & value) {
+
+  if (key == name("b.rambytes")) {
+
+    check(std::holds_alternative<uint64_t>(value), "setparam: b.rambytes has to be an uint64");
+    uint64_t ram_bytes = std::get<uint64_t>(value);
+    check(ram_bytes <= std::numeric_limits<uint32_t>::max(), "setparam: b.rambytes is out of range");
+    current.ram_bytes = ram_bytes;
+
+  } else if (key == name("d.net") || key == name("d.cpu")) {
+
+    check(std::holds_alternative<asset>(value), "setparam: delegated bandwidth has to be an asset");
+    asset amount = std::get<asset>(value);
+    check(amount.is_valid() && amount.amount >= 0, "setparam: delegated bandwidth can not be negative");
+    check(amount.symbol == system_tokens[0].second, "setparam: delegated bandwidth has to be in system token");
+
+    if (key == name("d.net")) {
+      current.delegated_net = amount;
+    } else {
+      current.delegated_cpu = amount;
+    }
+
+  } else if (key == name("log.account")) {
+
+    check(std::holds_alternative<name>(value), "setparam: log.account has to be a name");
+    current.log_account = std::get<name>(value);
+
+  } else if (key == name("info.account")) {
+
+    check(std::holds_alternative<name>(value), "setparam: info.account has to be a name");
+    name info_account = std::get<name>(value);
+    check(info_account == name() || is_account(info_account), "setparam: info.account does not exist");
+    current.info_account = info_account;
+
+  } else if (key == name("erase.empty")) {
+
+    check(std::holds_alternative<uint64_t>(value), "setparam: erase.empty has to be an uint64");
+    check(std::get<uint64_t>(value) <= 1, "setparam: erase.empty has to be 0 or 1");
+    current.erase_empty_balances = std::get<uint64_t>(value) == 1;
+
+  } else if (key == name("trade.window")) {
+
+    check(std::holds_alternative<uint64_t>(value), "setparam: trade.window has to be an uint64");
+    uint64_t window = std::get<uint64_t>(value);
+    check(window > 0 && window <= std::numeric_limits<uint32_t>::max(), "setparam: trade.window is out of range");
+    current.trade_payment_window = window;
+
+  } else {
+    check(false, "setparam: unknown parameter");
+  }
+
+  current.initialized |= param_bit(key);
+
 }
 
 ACTION daoreg::upsertattrs(const uint64_t &dao_id, std::vector<std::pair<std::string, VariantValue>> attributes) {
@@ -197,6 +326,20 @@ ACTION daoreg::addtoken(const uint64_t &dao_id, const name &token_contract, cons
     dao.tokens.push_back(std::pair(token_contract, token_symbol));
   });
 
+  token_registry_table registry_t(get_self(), get_self().value);
+  auto ritr = registry_t.find(token_contract.value);
+
+  if (ritr == registry_t.end()) {
+    registry_t.emplace(get_self(), [&](auto& item){
+      item.token_account = token_contract;
+      item.tokens = 1;
+    });
+  } else {
+    registry_t.modify(ritr, get_self(), [&](auto& item){
+      item.tokens += 1;
+    });
+  }
+
   tokens_table token_t(get_self(), dao_id);
 
   token_t.emplace(get_self(), [&](auto& item){
@@ -212,65 +355,120 @@ ACTION daoreg::addtoken(const uint64_t &dao_id, const name &token_contract, cons
 }
 
 // not a calleable action
-void daoreg::deposit(const name& from, const name& to, const asset& quantity, const std::string& memo) {
+// tokenreg is only written by addtoken, daos that registered their tokens
+// before it existed are counted in here, max_daos at a time
+ACTION daoreg::syncregistry(const uint64_t & start_dao_id, const uint64_t & max_daos) {
 
-  if(to == get_self()) {
-    check(!memo.empty(), "deposit: Memo can not be empty, especify dao_id");
+  require_auth(get_self());
 
-    int64_t dao_id;
-    name token_account;
-    bool token_is_registered = false;
+  check(max_daos > 0, "syncregistry: max_daos has to be higher than zero");
 
-    dao_id = stoi(memo);
-    check(dao_id >= 0, "deposit: Dao id has to be a positive number");
-    symbol token_symbol = quantity.symbol;
+  token_registry_table registry_t(get_self(), get_self().value);
 
-    dao_table _dao(get_self(), get_self().value);
+  if (start_dao_id == 0) {
+    auto ritr = registry_t.begin();
+    while (ritr != registry_t.end()) {
+      ritr = registry_t.erase(ritr);
+    }
+  }
 
-    if(dao_id == 0) {
+  dao_table _dao(get_self(), get_self().value);
 
-      for (auto& itr : system_tokens) {
-        if (itr.first == get_first_receiver() && itr.second == token_symbol) {
-          token_is_registered = true;
-          token_account = itr.first;
-          break;
-        }             
+  uint64_t visited = 0;
+  auto daoit = _dao.lower_bound(start_dao_id);
+
+  for (; daoit != _dao.end() && visited < max_daos; daoit++, visited++) {
+    for (auto& itr : daoit->tokens) {
+      auto ritr = registry_t.find(itr.first.value);
+
+      if (ritr == registry_t.end()) {
+        registry_t.emplace(get_self(), [&](auto& item){
+          item.token_account = itr.first;
+          item.tokens = 1;
+        });
+      } else {
+        registry_t.modify(ritr, get_self(), [&](auto& item){
+          item.tokens += 1;
+        });
       }
-      check(token_is_registered, "deposit: This is not a supported system token");
-    } else {
-      auto daoit = _dao.find(dao_id);
-      check(daoit != _dao.end(), "deposit: Organization not found");
-      auto dao_tokens = daoit->tokens;
-
-      for (auto& itr : dao_tokens) {
-        if (itr.first == get_first_receiver() && itr.second == token_symbol) {
-          token_is_registered = true;
-          token_account = itr.first;
-          break;
-        }
-      }
-      check(token_is_registered, "deposit: Token is not supported by a registred Dao");
     }
+  }
 
-    balances_table _balances(get_self(), from.value);
+  if (daoit != _dao.end()) {
+    print("{\"next_dao_id\":" + std::to_string(daoit->dao_id) + "}");
+  }
 
-    auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
-    auto itr = balances_by_token_account_token.find((uint128_t(token_account.value) << 64) + token_symbol.raw());
+}
 
-    if (itr == balances_by_token_account_token.end()) {
-      _balances.emplace(get_self(), [&](auto& user){
-        user.id = _balances.available_primary_key();
-        user.available = quantity;
-        user.locked = asset(0, token_symbol);
-        user.dao_id = dao_id;
-        user.token_account = token_account;
-      });
-    } else {
-      balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
-        user.available += quantity;
-      });
+void daoreg::depositmany(const name& from, const std::vector<transfer_entry>& transfers) {
+
+  for (const auto& t : transfers) {
+    deposit(from, t.to, t.quantity, t.memo);
+  }
+
+}
+
+void daoreg::deposit(const name& from, const name& to, const asset& quantity, const std::string& memo) {
+
+  if (to != get_self()) {
+    return;
+  }
+
+  check(!memo.empty(), "deposit: Memo can not be empty, especify dao_id");
+
+  memo::deposit_memo parsed = memo::parse_deposit(memo);
+
+  name token_account = get_first_receiver();
+  symbol token_symbol = quantity.symbol;
+
+  // system tokens are known at compile time, no table reads
+  bool is_system_token = false;
+  for (auto& itr : system_tokens) {
+    if (itr.first == token_account && itr.second == token_symbol) {
+      is_system_token = true;
+      break;
     }
   }
+
+  // system tokens pay for offers of any dao, other deposits to a dao need the dao to register the token
+  if (parsed.dao_id == 0 || (is_system_token && parsed.route == memo::route_offer)) {
+
+    check(is_system_token, "deposit: This is not a supported system token");
+
+  } else {
+
+    // unknown token contracts are rejected with a single primary key lookup
+    token_registry_table registry_t(get_self(), get_self().value);
+    check(registry_t.find(token_account.value) != registry_t.end(), "deposit: Token is not supported by a registred Dao");
+
+    tokens_table token_t(get_self(), parsed.dao_id);
+    auto token_by_symbol = token_t.get_index<name("bytknsymbol")>();
+    auto sitr = token_by_symbol.find(token_symbol.raw());
+
+    check(
+      sitr != token_by_symbol.end() && sitr->token_account == token_account, 
+      "deposit: Token is not supported by a registred Dao"
+    );
+
+  }
+
+  if (parsed.route == memo::route_offer) {
+    emit_event(name("logdeposit"), from, parsed.dao_id, token_account, quantity);
+    deposit_and_trade(from, parsed.dao_id, quantity, token_account, parsed.args);
+    return;
+  }
+
+  name beneficiary = from;
+
+  if (parsed.beneficiary != name()) {
+    check(is_account(parsed.beneficiary), "deposit: Beneficiary account does not exist");
+    beneficiary = parsed.beneficiary;
+  }
+
+  add_balance(beneficiary, quantity, token_account, parsed.dao_id);
+
+  emit_event(name("logdeposit"), beneficiary, parsed.dao_id, token_account, quantity);
+
 }
 
 ACTION daoreg::withdraw ( const name &account, const name &token_account, const asset &quantity ) {
@@ -286,9 +484,13 @@ ACTION daoreg::withdraw ( const name &account, const name &token_account, const
   check(itr != balances_by_token_account_token.end(), "Token account and symbol are not registered in your account");
   check(itr->available >= quantity, "You do not have enough balance");
 
-  balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
-    user.available -= quantity;
-  });
+  if (itr->available == quantity && itr->locked.amount == 0 && params.get().erase_empty_balances) {
+    balances_by_token_account_token.erase(itr);
+  } else {
+    balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
+      user.available -= quantity;
+    });
+  }
 
   action(
       permission_level{get_self(), name("active")},
@@ -297,6 +499,397 @@ ACTION daoreg::withdraw ( const name &account, const name &token_account, const
       std::make_tuple(get_self(), account, quantity, string("withdraw from here"))
   ).send();
 
+  emit_event(name("logwithdraw"), account, token_account, quantity);
+
+}
+
+ACTION daoreg::withdrawmany ( const name &account, const std::vector<std::pair<name, asset>> &withdrawals ) {
+  require_auth(account);
+  check(withdrawals.size() > 0, "withdrawmany: There is nothing to withdraw");
+
+  // one debit and one outgoing transfer per token contract and symbol
+  std::map<std::pair<name, symbol>, asset> totals;
+
+  for (auto& [token_account, quantity] : withdrawals) {
+    check(quantity.is_valid() && quantity.amount > 0, "Amount to withdraw has to be higher than zero");
+
+    auto titr = totals.find({token_account, quantity.symbol});
+    if (titr == totals.end()) {
+      totals.emplace(std::make_pair(token_account, quantity.symbol), quantity);
+    } else {
+      titr->second += quantity;
+    }
+  }
+
+  balances_table _balances(get_self(), account.value);
+  auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
+
+  for (auto& [key, quantity] : totals) {
+    auto itr = balances_by_token_account_token.find((uint128_t(key.first.value) << 64) + key.second.raw());
+
+    check(itr != balances_by_token_account_token.end(), "Token account and symbol are not registered in your account");
+    check(itr->available >= quantity, "You do not have enough balance");
+
+    if (itr->available == quantity && itr->locked.amount == 0 && params.get().erase_empty_balances) {
+      balances_by_token_account_token.erase(itr);
+    } else {
+      balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
+        user.available -= quantity;
+      });
+    }
+
+    send_transfer(get_self(), account, quantity, string("withdraw from here"), key.first);
+    emit_event(name("logwithdraw"), account, key.first, quantity);
+  }
+
+}
+
+ACTION daoreg::upsertuser (
+  const name & account,
+  const mapss & contact_methods,
+  const name & time_zone,
+  const name & fiat_currency) {
+
+  require_auth(account);
+
+  user_tables user_t(get_self(), get_self().value);
+  auto uitr = user_t.find(account.value);
+
+  if (uitr == user_t.end()) {
+    user_t.emplace(account, [&](auto& item){
+      item.account = account;
+      item.contact_methods = contact_methods;
+      item.time_zone = time_zone;
+      item.fiat_currency = fiat_currency;
+      item.is_arbiter = false;
+    });
+    return;
+  }
+
+  bool reindex = uitr->time_zone != time_zone || uitr->fiat_currency != fiat_currency;
+
+  user_t.modify(uitr, account, [&](auto& item){
+    item.contact_methods = contact_methods;
+    item.time_zone = time_zone;
+    item.fiat_currency = fiat_currency;
+  });
+
+  if (!reindex) return;
+
+  // keep the denormalized discovery keys of the user's payment methods in sync
+  payment_method_tables paymethod_t(get_self(), get_self().value);
+  auto paymethods_by_account = paymethod_t.get_index<name("byacctmethod")>();
+  auto pitr = paymethods_by_account.lower_bound(uint128_t(account.value) << 64);
+
+  while (pitr != paymethods_by_account.end() && pitr->account == account) {
+    paymethods_by_account.modify(pitr, account, [&](auto& item){
+      item.time_zone = time_zone;
+      item.fiat_currency = fiat_currency;
+    });
+    pitr++;
+  }
+
+}
+
+ACTION daoreg::deluser (const name & account) {
+
+  require_auth( has_auth(account) ? account : get_self() );
+
+  user_tables user_t(get_self(), get_self().value);
+  auto uitr = user_t.find(account.value);
+  check(uitr != user_t.end(), "User not found");
+
+  payment_method_tables paymethod_t(get_self(), get_self().value);
+  auto paymethods_by_account = paymethod_t.get_index<name("byacctmethod")>();
+  auto pitr = paymethods_by_account.lower_bound(uint128_t(account.value) << 64);
+
+  while (pitr != paymethods_by_account.end() && pitr->account == account) {
+    pitr = paymethods_by_account.erase(pitr);
+  }
+
+  user_t.erase(uitr);
+
+}
+
+ACTION daoreg::addpaymethod (
+  const name & account,
+  const name & method,
+  const std::string & details) {
+
+  require_auth(account);
+
+  check(details.size() <= 256, "Payment method details have more than 256 bytes");
+
+  user_tables user_t(get_self(), get_self().value);
+  auto uitr = user_t.find(account.value);
+  check(uitr != user_t.end(), "User not found");
+
+  payment_method_tables paymethod_t(get_self(), get_self().value);
+  auto paymethods_by_account = paymethod_t.get_index<name("byacctmethod")>();
+  auto pitr = paymethods_by_account.find((uint128_t(account.value) << 64) + method.value);
+
+  if (pitr == paymethods_by_account.end()) {
+    paymethod_t.emplace(account, [&](auto& item){
+      item.id = paymethod_t.available_primary_key();
+      item.account = account;
+      item.method = method;
+      item.fiat_currency = uitr->fiat_currency;
+      item.time_zone = uitr->time_zone;
+      item.details = details;
+    });
+  } else {
+    paymethods_by_account.modify(pitr, account, [&](auto& item){
+      item.details = details;
+    });
+  }
+
+}
+
+ACTION daoreg::delpaymethod (const name & account, const name & method) {
+
+  require_auth(account);
+
+  payment_method_tables paymethod_t(get_self(), get_self().value);
+  auto paymethods_by_account = paymethod_t.get_index<name("byacctmethod")>();
+  auto pitr = paymethods_by_account.find((uint128_t(account.value) << 64) + method.value);
+
+  check(pitr != paymethods_by_account.end(), "Payment method not found");
+
+  paymethods_by_account.erase(pitr);
+
+}
+
+ACTION daoreg::setarbiter (const name & account, const bool & is_arbiter) {
+
+  require_auth(get_self());
+
+  user_tables user_t(get_self(), get_self().value);
+  auto uitr = user_t.find(account.value);
+  check(uitr != user_t.end(), "User not found");
+
+  user_t.modify(uitr, same_payer, [&](auto& item){
+    item.is_arbiter = is_arbiter;
+  });
+
+}
+
+ACTION daoreg::opentrade (
+  const uint64_t & dao_id,
+  const name & seller,
+  const name & buyer,
+  const asset & quantity,
+  const asset & fiat_amount,
+  const name & payment_method,
+  const name & arbiter) {
+
+  require_auth(seller);
+
+  check(seller != buyer, "opentrade: Seller and buyer can not be the same account");
+  check(quantity.is_valid() && quantity.amount > 0, "opentrade: Quantity has to be higher than zero");
+  check(fiat_amount.is_valid() && fiat_amount.amount > 0, "opentrade: Fiat amount has to be higher than zero");
+
+  user_tables user_t(get_self(), get_self().value);
+
+  auto sitr = user_t.find(seller.value);
+  check(sitr != user_t.end(), "opentrade: Seller is not registered");
+  check(user_t.find(buyer.value) != user_t.end(), "opentrade: Buyer is not registered");
+
+  auto aitr = user_t.find(arbiter.value);
+  check(aitr != user_t.end() && aitr->is_arbiter, "opentrade: Arbiter not found");
+  check(aitr->fiat_currency == sitr->fiat_currency, "opentrade: Arbiter does not handle the seller's fiat currency");
+  check(arbiter != seller && arbiter != buyer, "opentrade: Arbiter can not be a party of the trade");
+
+  payment_method_tables paymethod_t(get_self(), get_self().value);
+  auto paymethods_by_account = paymethod_t.get_index<name("byacctmethod")>();
+  check(
+    paymethods_by_account.find((uint128_t(seller.value) << 64) + payment_method.value) != paymethods_by_account.end(),
+    "opentrade: Seller does not accept this payment method"
+  );
+
+  name token_account = get_token_account(dao_id, quantity.symbol);
+
+  lock_balance(seller, quantity, token_account);
+
+  trades_table trade_t(get_self(), dao_id);
+
+  trade_t.emplace(get_self(), [&](auto & item){
+    item.trade_id = trade_t.available_primary_key();
+    item.seller = seller;
+    item.buyer = buyer;
+    item.arbiter = arbiter;
+    item.quantity = quantity;
+    item.fiat_amount = fiat_amount;
+    item.payment_method = payment_method;
+    item.token_account = token_account;
+    item.status = util::trade_status_open;
+    item.payment_deadline = time_point_sec(current_time_point().sec_since_epoch() + params.get().trade_payment_window);
+  });
+
+}
+
+ACTION daoreg::confirmpaid (const uint64_t & dao_id, const uint64_t & trade_id) {
+
+  trades_table trade_t(get_self(), dao_id);
+
+  auto titr = trade_t.find(trade_id);
+  check(titr != trade_t.end(), "confirmpaid: Trade not found");
+
+  require_auth(titr->buyer);
+
+  check(titr->status == util::trade_status_open, "confirmpaid: Trade is not waiting for a payment");
+
+  // past the deadline the seller is free to cancel, a late confirmation would lock the seller in
+  check(current_time_point().sec_since_epoch() <= titr->payment_deadline.sec_since_epoch(), "confirmpaid: Payment window is over");
+
+  trade_t.modify(titr, get_self(), [&](auto & item){
+    item.status = util::trade_status_paid;
+  });
+
+}
+
+ACTION daoreg::releasetrade (const uint64_t & dao_id, const uint64_t & trade_id) {
+
+  trades_table trade_t(get_self(), dao_id);
+
+  auto titr = trade_t.find(trade_id);
+  check(titr != trade_t.end(), "releasetrade: Trade not found");
+
+  require_auth(titr->seller);
+
+  check(titr->status != util::trade_status_disputed, "releasetrade: Trade is disputed, only the arbiter can resolve it");
+
+  settle_trade(dao_id, trade_id, titr->buyer);
+
+}
+
+ACTION daoreg::canceltrade (const uint64_t & dao_id, const uint64_t & trade_id, const name & account) {
+
+  require_auth(account);
+
+  trades_table trade_t(get_self(), dao_id);
+
+  auto titr = trade_t.find(trade_id);
+  check(titr != trade_t.end(), "canceltrade: Trade not found");
+
+  check(titr->status == util::trade_status_open, "canceltrade: Only trades waiting for a payment can be canceled");
+
+  // the buyer can back out at any time, the seller only once the payment window is over
+  if (account == titr->seller) {
+    check(current_time_point().sec_since_epoch() > titr->payment_deadline.sec_since_epoch(), "canceltrade: Payment window is still open");
+  } else {
+    check(account == titr->buyer, "canceltrade: Only the seller or the buyer can cancel the trade");
+  }
+
+  settle_trade(dao_id, trade_id, titr->seller);
+
+}
+
+ACTION daoreg::disputetrade (const uint64_t & dao_id, const uint64_t & trade_id, const name & account) {
+
+  require_auth(account);
+
+  trades_table trade_t(get_self(), dao_id);
+
+  auto titr = trade_t.find(trade_id);
+  check(titr != trade_t.end(), "disputetrade: Trade not found");
+
+  check(account == titr->seller || account == titr->buyer, "disputetrade: Only the seller or the buyer can dispute the trade");
+  check(titr->status == util::trade_status_paid, "disputetrade: Only paid trades can be disputed");
+
+  trade_t.modify(titr, get_self(), [&](auto & item){
+    item.status = util::trade_status_disputed;
+  });
+
+}
+
+ACTION daoreg::resolvetrade (const uint64_t & dao_id, const uint64_t & trade_id, const bool & release) {
+
+  trades_table trade_t(get_self(), dao_id);
+
+  auto titr = trade_t.find(trade_id);
+  check(titr != trade_t.end(), "resolvetrade: Trade not found");
+
+  require_auth(titr->arbiter);
+
+  check(titr->status == util::trade_status_disputed, "resolvetrade: Trade is not disputed");
+
+  settle_trade(dao_id, trade_id, release ? titr->buyer : titr->seller);
+
+}
+
+ACTION daoreg::logdeposit (
+  const name & account,
+  const uint64_t & dao_id,
+  const name & token_account,
+  const asset & quantity) {
+  notify_log_account();
+}
+
+ACTION daoreg::logwithdraw (
+  const name & account,
+  const name & token_account,
+  const asset & quantity) {
+  notify_log_account();
+}
+
+ACTION daoreg::lognewoffer (
+  const uint64_t & dao_id,
+  const uint64_t & offer_id,
+  const name & creator,
+  const asset & quantity,
+  const asset & price_per_unit,
+  const uint8_t & type) {
+  notify_log_account();
+}
+
+ACTION daoreg::logfill (
+  const uint64_t & dao_id,
+  const uint64_t & offer_id,
+  const name & maker,
+  const name & taker,
+  const asset & quantity,
+  const asset & cost) {
+  notify_log_account();
+}
+
+ACTION daoreg::logcancel (
+  const uint64_t & dao_id,
+  const uint64_t & offer_id,
+  const name & creator,
+  const asset & remaining) {
+  notify_log_account();
+}
+
+ACTION daoreg::logamend (
+  const uint64_t & dao_id,
+  const uint64_t & offer_id,
+  const name & creator,
+  const asset & quantity,
+  const asset & price_per_unit) {
+  notify_log_account();
+}
+
+ACTION daoreg::logsettle (
+  const uint64_t & dao_id,
+  const uint64_t & trade_id,
+  const name & seller,
+  const name & buyer,
+  const asset & quantity,
+  const name & beneficiary) {
+  notify_log_account();
+}
+
+void daoreg::notify_log_account() {
+
+  require_auth(get_self());
+
+  // the log account is optional, events are always visible in the action traces
+  name log_account = params.get().log_account;
+
+  if (log_account != name() && is_account(log_account)) {
+    require_recipient(log_account);
+  }
+
 }
 
 ACTION daoreg::createoffer ( 
@@ -308,25 +901,83 @@ ACTION daoreg::createoffer (
 
   require_auth(creator);
 
+  check(quantity.is_valid() && quantity.amount > 0, "createoffer: Quantity has to be higher than zero");
+  check(price_per_unit.is_valid() && price_per_unit.amount > 0, "createoffer: Price has to be higher than zero");
+
   symbol token_symbol = quantity.symbol;
 
   tokens_table token_t(get_self(), dao_id);
 
-  auto token_by_symbol = token_t.get_index<name("bytknsymbol")>();
-  auto sitr = token_by_symbol.find(token_symbol.raw());
+  auto token_by_symbol = token_t.get_index<name("bytknsymbol")>();
+  auto sitr = token_by_symbol.find(token_symbol.raw());
+
+  check(sitr != token_by_symbol.end(), "createoffer: Token not found");
+
+  // has_enough_balance(dao_id, creator, quantity); // balances table daoreg
+
+  if ( type == util::type_sell_offer) {
+
+    createselloffer(dao_id, creator, quantity, price_per_unit, sitr->token_id);
+
+  } else if ( type == util::type_buy_offer) {
+
+    createbuyoffer(dao_id, creator, quantity, price_per_unit, sitr->token_id);
+
+  } else if ( type == util::type_ioc_sell || type == util::type_fok_sell ) {
+
+    takeoffers(dao_id, creator, quantity, price_per_unit, sitr->token_id, util::type_sell_offer, type == util::type_fok_sell);
+
+  } else if ( type == util::type_ioc_buy || type == util::type_fok_buy ) {
+
+    takeoffers(dao_id, creator, quantity, price_per_unit, sitr->token_id, util::type_buy_offer, type == util::type_fok_buy);
+
+  } else {
+
+    check(false, "createoffer: Invalid offer type");
+
+  }
+
+}
+
+// market order, price_per_unit is the worst price accepted
+void daoreg::takeoffers ( 
+  const uint64_t & dao_id, 
+  const name & creator, 
+  const asset & quantity, 
+  const asset & limit_price,
+  const uint8_t & token_id,
+  const uint8_t & taker_type,
+  const bool & fill_or_kill) {
+
+  name daos_token_account = get_token_account( dao_id, quantity.symbol );
+  name system_token_account = get_token_account( dao_id, limit_price.symbol );
 
-  check(sitr != token_by_symbol.end(), "createoffer: Token not found");
+  asset filled, spent;
 
-  // has_enough_balance(dao_id, creator, quantity); // balances table daoreg
+  if (taker_type == util::type_buy_offer) {
+    asset max_cost = pricing::cost(quantity, limit_price);
+    has_enough_balance(dao_id, creator, max_cost);
 
-  if ( type == util::type_sell_offer) {
+    std::tie(filled, spent) = sweep_offers(dao_id, creator, token_id, taker_type, quantity, max_cost, limit_price);
+  } else {
+    has_enough_balance(dao_id, creator, quantity);
 
-    createselloffer(dao_id, creator, quantity, price_per_unit, sitr->token_id);
+    std::tie(filled, spent) = sweep_offers(dao_id, creator, token_id, taker_type, 
+      quantity, asset(asset::max_amount, limit_price.symbol), limit_price);
+  }
 
-  } else if ( type == util::type_buy_offer) {
+  // failing here reverts every fill of the sweep
+  check(!fill_or_kill || filled == quantity, "createoffer: Fill or kill offer can not be filled completely");
 
-    createbuyoffer(dao_id, creator, quantity, price_per_unit, sitr->token_id);
+  if (filled.amount == 0) return;
 
+  // taker side, the makers were settled by fill_offer
+  if (taker_type == util::type_buy_offer) {
+    remove_balance( creator, spent, system_token_account, dao_id );
+    add_balance( creator, filled, daos_token_account, dao_id );
+  } else {
+    remove_balance( creator, filled, daos_token_account, dao_id );
+    add_balance( creator, spent, system_token_account, dao_id );
   }
 
 }
@@ -341,9 +992,10 @@ void daoreg::storeoffer (
   const uint8_t & type) {
 
   offers_table offer_t(get_self(), dao_id);
+  uint64_t offer_id = offer_t.available_primary_key();
 
     offer_t.emplace(get_self(), [&](auto & item){
-      item.offer_id = offer_t.available_primary_key();
+      item.offer_id = offer_id;
       item.creator = creator;
       item.available_quantity = quantity;
       item.total_quantity = quantity;
@@ -352,13 +1004,10 @@ void daoreg::storeoffer (
       item.creation_date = current_time_point();
       item.type = type;
       item.token_idx = token_id;
-      item.match_id = (uint128_t(0xF                  & type)                   << 124) 
-                      + (uint128_t(0xF                & util::status_active)    << 122)
-                      + (uint128_t(0xF                & token_id)               << 120)
-                      + (uint128_t(0xFFFFFFFFFFFFFFFF & price_per_unit.amount)  << 56 ) 
-                      + (uint128_t(0xFFFFFFFFFFFFFF   &  std::numeric_limits<uint64_t>::max() - current_time_point().sec_since_epoch()));
+      item.match_id = item.by_offer_match();
     });
 
+  emit_event(name("lognewoffer"), dao_id, offer_id, creator, quantity, price_per_unit, type);
 
 }
 
@@ -369,8 +1018,7 @@ void daoreg::createbuyoffer (
   const asset & price_per_unit,
   const uint8_t & token_id) {
 
-  // divided by 10000 to normalize system token
-  asset cost = asset(quantity.amount * price_per_unit.amount / 10000, price_per_unit.symbol); 
+  asset cost = pricing::cost(quantity, price_per_unit);
   has_enough_balance(dao_id, creator, cost);
 
   offers_table offer_t(get_self(), dao_id);
@@ -448,11 +1096,70 @@ ACTION daoreg::removeoffer (const uint64_t & dao_id, const uint64_t & offer_id)
 
   require_auth( has_auth(ofit->creator) ? ofit->creator : get_self() );
 
+  emit_event(name("logcancel"), dao_id, offer_id, ofit->creator, ofit->available_quantity);
+
   offer_t.erase(ofit);
 
 }
 
 
+// Changes an offer without erasing it, so it keeps its offer_id. A smaller
+// quantity at the same price keeps the time priority, a new price or a
+// larger quantity resets creation_date, which offers::time_priority turns
+// into the back of its price level on both sides of the book.
+ACTION daoreg::amendoffer (
+  const uint64_t & dao_id, 
+  const uint64_t & offer_id,
+  const asset & new_quantity,
+  const asset & new_price) {
+
+  offers_table offer_t(get_self(), dao_id);
+
+  auto ofit = offer_t.find(offer_id);
+  check(ofit != offer_t.end(), "Offer not found");
+
+  require_auth(ofit->creator);
+
+  check(ofit->status == util::status_active, "Offer is not active");
+  check(new_quantity.is_valid() && new_quantity.amount > 0, "amendoffer: Quantity has to be higher than zero");
+  check(new_price.is_valid() && new_price.amount > 0, "amendoffer: Price has to be higher than zero");
+  check(new_quantity.symbol == ofit->available_quantity.symbol, "amendoffer: Quantity symbol mismatch");
+  check(new_price.symbol == ofit->price_per_unit.symbol, "amendoffer: Price symbol mismatch");
+
+  bool price_changed = new_price != ofit->price_per_unit;
+  bool quantity_increased = new_quantity > ofit->available_quantity;
+
+  check(price_changed || new_quantity != ofit->available_quantity, "amendoffer: Nothing to change");
+
+  // only what the offer needs on top of the current one is checked
+  if (ofit->type == util::type_buy_offer) {
+    asset new_cost = pricing::cost(new_quantity, new_price);
+    if (new_cost > pricing::cost(ofit->available_quantity, ofit->price_per_unit)) {
+      has_enough_balance(dao_id, ofit->creator, new_cost);
+    }
+  } else if (quantity_increased) {
+    has_enough_balance(dao_id, ofit->creator, new_quantity);
+  }
+
+  // an amended offer rests in the book, it may not cross the best counter-offer
+  if (price_changed) {
+    check(!crosses_book(dao_id, ofit->token_idx, ofit->type, new_price), "amendoffer: New price crosses the best counter-offer");
+  }
+
+  offer_t.modify(ofit, get_self(), [&](auto & item){
+    item.total_quantity += new_quantity - item.available_quantity;
+    item.available_quantity = new_quantity;
+    item.price_per_unit = new_price;
+    if (price_changed || quantity_increased) {
+      item.creation_date = current_time_point();
+    }
+    item.match_id = item.by_offer_match();
+  });
+
+  emit_event(name("logamend"), dao_id, offer_id, ofit->creator, new_quantity, new_price);
+
+}
+
 ACTION daoreg::acceptoffer (const uint64_t & dao_id, const name & account, const uint64_t & offer_id) {
 
   require_auth(account);
@@ -479,7 +1186,7 @@ ACTION daoreg::acceptoffer (const uint64_t & dao_id, const name & account, const
 
 void daoreg::resolve_buy_offer(
   const uint64_t & dao_id,
-  const uint8_t & offer_id,
+  const uint64_t & offer_id,
   const name & seller ) {
 
   /*
@@ -497,34 +1204,24 @@ void daoreg::resolve_buy_offer(
 
   check(ofit->status == util::status_active, "Offer is not active");
 
-  // divided by 10000 to normalize system token
-
-  asset cost = asset( ofit->available_quantity.amount * ofit->price_per_unit.amount / 10000, ofit->price_per_unit.symbol );  
-  has_enough_balance(dao_id, seller, ofit->available_quantity);
+  asset quantity = ofit->available_quantity;
+  has_enough_balance(dao_id, seller, quantity);
 
-  name daos_token_account = get_token_account( dao_id, ofit->available_quantity.symbol );
+  name daos_token_account = get_token_account( dao_id, quantity.symbol );
   name system_token_account = get_token_account( dao_id, ofit->price_per_unit.symbol );
 
-  // transfer system tokens
-  remove_balance( ofit->creator, cost, system_token_account, dao_id );
-  add_balance( seller, cost, system_token_account, dao_id );
-
+  asset cost = fill_offer( dao_id, offer_id, seller, quantity );
 
-  // transfer daos tokens
-  add_balance( ofit->creator, ofit->available_quantity, daos_token_account, dao_id );
-  remove_balance(seller, ofit->available_quantity, daos_token_account, dao_id );
-
-  offer_t.modify(ofit, get_self(), [&](auto& item){
-    item.available_quantity = asset(0, ofit-> available_quantity.symbol);
-    item.status = util::status_closed;
-  });
+  // seller side
+  remove_balance( seller, quantity, daos_token_account, dao_id );
+  add_balance( seller, cost, system_token_account, dao_id );
 
 }
 
 
 void daoreg::resolve_sell_offer(
   const uint64_t & dao_id,
-  const uint8_t & offer_id,
+  const uint64_t & offer_id,
   const name & buyer) {
 
   /*
@@ -543,28 +1240,262 @@ void daoreg::resolve_sell_offer(
   check(ofit->status == util::status_active, "Offer is not active");
 
   // pays in system token
-  // divided by 10000 to normalize system token
-
-  asset cost = asset( ofit->available_quantity.amount * ofit->price_per_unit.amount / 10000, ofit->price_per_unit.symbol );  
-  has_enough_balance(dao_id, buyer, cost);
+  asset quantity = ofit->available_quantity;
+  has_enough_balance(dao_id, buyer, pricing::cost( quantity, ofit->price_per_unit ));
 
-  name daos_token_account = get_token_account( dao_id, ofit->available_quantity.symbol );
+  name daos_token_account = get_token_account( dao_id, quantity.symbol );
   name system_token_account = get_token_account( dao_id, ofit->price_per_unit.symbol );
 
-  // transfer system tokens
-  add_balance( ofit->creator, cost, system_token_account, dao_id );
+  asset cost = fill_offer( dao_id, offer_id, buyer, quantity );
+
+  // buyer side
   remove_balance( buyer, cost, system_token_account, dao_id );
+  add_balance( buyer, quantity, daos_token_account, dao_id );
+
+}
+
+asset daoreg::fill_offer(
+  const uint64_t & dao_id,
+  const uint64_t & offer_id,
+  const name & taker,
+  const asset & quantity) {
+
+  offers_table offer_t(get_self(), dao_id);
+
+  auto ofit = offer_t.find(offer_id);
+  check(ofit != offer_t.end(), "Offer not found");
+  check(ofit->status == util::status_active, "Offer is not active");
+  check(quantity.amount > 0 && quantity <= ofit->available_quantity, "fill_offer: Invalid fill quantity");
+
+  asset cost = pricing::cost( quantity, ofit->price_per_unit );
+
+  name daos_token_account = get_token_account( dao_id, quantity.symbol );
+  name system_token_account = get_token_account( dao_id, ofit->price_per_unit.symbol );
 
+  // only the maker side is settled here, the taker side belongs to the caller
+  if (ofit->type == util::type_buy_offer) {
+    remove_balance( ofit->creator, cost, system_token_account, dao_id );
+    add_balance( ofit->creator, quantity, daos_token_account, dao_id );
+  } else {
+    remove_balance( ofit->creator, quantity, daos_token_account, dao_id );
+    add_balance( ofit->creator, cost, system_token_account, dao_id );
+  }
 
-  // transfer daos tokens
-  remove_balance( ofit->creator, ofit->available_quantity, daos_token_account, dao_id );
-  add_balance( buyer, ofit->available_quantity, daos_token_account, dao_id );
+  record_trade( dao_id, ofit->token_idx, ofit->price_per_unit, quantity, cost );
+  emit_event( name("logfill"), dao_id, ofit->offer_id, ofit->creator, taker, quantity, cost );
 
   offer_t.modify(ofit, get_self(), [&](auto& item){
-    item.available_quantity = asset(0, ofit-> available_quantity.symbol);
-    item.status = util::status_closed;
+    item.available_quantity -= quantity;
+    if (item.available_quantity.amount == 0) {
+      item.status = util::status_closed;
+    }
   });
 
+  return cost;
+
+}
+
+std::pair<asset, asset> daoreg::sweep_offers(
+  const uint64_t & dao_id,
+  const name & taker,
+  const uint8_t & token_idx,
+  const uint8_t & taker_type,
+  const asset & max_quantity,
+  const asset & max_cost,
+  const asset & limit_price) {
+
+  asset filled = asset(0, max_quantity.symbol);
+  asset spent = asset(0, max_cost.symbol);
+
+  uint8_t maker_type = taker_type == util::type_buy_offer ? util::type_sell_offer : util::type_buy_offer;
+
+  offers_table offer_t(get_self(), dao_id);
+  auto by_offer_match = offer_t.get_index<eosio::name("byoffermatch")>();
+
+  uint128_t prefix = ( uint128_t(0xF & maker_type) << 124 )
+    + ( uint128_t(0xF & util::status_active) << 122 )
+    + ( uint128_t(0xF & token_idx) << 120 );
+
+  name daos_token_account = get_token_account( dao_id, max_quantity.symbol );
+  name system_token_account = get_token_account( dao_id, limit_price.symbol );
+
+  for (uint8_t matches = 0; matches < util::max_offer_matches && filled < max_quantity && spent < max_cost; matches++) {
+
+    // filled offers leave the active range, so the best offer is looked up again on every round
+    auto itr = by_offer_match.end();
+
+    if (taker_type == util::type_buy_offer) {
+      // lowest ask first, the oldest one of its price level
+      itr = by_offer_match.lower_bound(prefix);
+      if (itr == by_offer_match.end()) break;
+    } else {
+      // highest bid first, the oldest one of its price level
+      auto upper = by_offer_match.lower_bound(prefix + (uint128_t(1) << 120));
+      if (upper == by_offer_match.begin()) break;
+      itr = std::prev(upper);
+    }
+
+    if (itr->type != maker_type || itr->status != util::status_active || itr->token_idx != token_idx) break;
+    if (itr->creator == taker) break;
+
+    if (taker_type == util::type_buy_offer) {
+      if (itr->price_per_unit > limit_price) break;
+    } else {
+      if (itr->price_per_unit < limit_price) break;
+    }
+
+    asset quantity = std::min(itr->available_quantity, max_quantity - filled);
+
+    if (taker_type == util::type_buy_offer) {
+      quantity = std::min(quantity, pricing::quantity(max_cost - spent, itr->price_per_unit, quantity.symbol));
+    }
+
+    if (quantity.amount == 0) break;
+
+    // offers don't lock their funds, a maker that can no longer pay is
+    // closed and skipped instead of failing the whole sweep
+    asset maker_pays = taker_type == util::type_buy_offer ? quantity : pricing::cost(quantity, itr->price_per_unit);
+    name maker_token_account = taker_type == util::type_buy_offer ? daos_token_account : system_token_account;
+
+    if (get_available(itr->creator, maker_token_account, maker_pays.symbol) < maker_pays) {
+      close_offer(dao_id, itr->offer_id);
+      continue;
+    }
+
+    spent += fill_offer(dao_id, itr->offer_id, taker, quantity);
+    filled += quantity;
+  }
+
+  return { filled, spent };
+
+}
+
+void daoreg::deposit_and_trade(
+  const name & from,
+  const uint64_t & dao_id,
+  const asset & quantity,
+  const name & token_account,
+  std::string_view args) {
+
+  memo::offer_memo parsed = memo::parse_offer(args, system_tokens[0].second.precision());
+
+  asset limit_price = asset(parsed.price, system_tokens[0].second);
+  check(limit_price.amount > 0, "deposit: Offer price has to be higher than zero");
+
+  tokens_table token_t(get_self(), dao_id);
+
+  uint8_t taker_type;
+  uint8_t token_id = 0;
+  symbol daos_symbol;
+  name daos_token_account;
+  name system_token_account = system_tokens[0].first;
+
+  if (quantity.symbol == system_tokens[0].second) {
+
+    // system token in, buying the daos token named in the memo
+    check(parsed.token != symbol_code(), "deposit: Offer memo has to include the token to buy");
+    taker_type = util::type_buy_offer;
+
+    for (auto itr = token_t.begin(); itr != token_t.end(); itr++) {
+      if (itr->token_symbol.code() == parsed.token) {
+        token_id = itr->token_id;
+        daos_symbol = itr->token_symbol;
+        daos_token_account = itr->token_account;
+        break;
+      }
+    }
+
+  } else {
+
+    // daos token in, selling it
+    taker_type = util::type_sell_offer;
+
+    auto token_by_symbol = token_t.get_index<name("bytknsymbol")>();
+    auto sitr = token_by_symbol.find(quantity.symbol.raw());
+
+    if (sitr != token_by_symbol.end()) {
+      token_id = sitr->token_id;
+      daos_symbol = sitr->token_symbol;
+      daos_token_account = sitr->token_account;
+    }
+
+  }
+
+  check(token_id != 0, "deposit: Token not found");
+
+  asset filled, spent;
+
+  if (taker_type == util::type_buy_offer) {
+    std::tie(filled, spent) = sweep_offers(dao_id, from, token_id, taker_type, 
+      asset(asset::max_amount, daos_symbol), quantity, limit_price);
+  } else {
+    std::tie(filled, spent) = sweep_offers(dao_id, from, token_id, taker_type, 
+      quantity, asset(asset::max_amount, system_tokens[0].second), limit_price);
+  }
+
+  // proceeds of the fills, credited once or sent back right away
+  asset proceeds = taker_type == util::type_buy_offer ? filled : spent;
+  name proceeds_account = taker_type == util::type_buy_offer ? daos_token_account : system_token_account;
+
+  // whatever was not matched rests in the book as a limit order
+  asset remaining = taker_type == util::type_buy_offer ? quantity - spent : quantity - filled;
+
+  if (proceeds.amount > 0) {
+    if (parsed.withdraw) {
+      send_transfer(get_self(), from, proceeds, string("proceeds from offer"), proceeds_account);
+      emit_event(name("logwithdraw"), from, proceeds_account, proceeds);
+    } else {
+      add_balance(from, proceeds, proceeds_account, dao_id);
+    }
+  }
+
+  if (remaining.amount > 0) {
+    add_balance(from, remaining, token_account, dao_id);
+
+    asset offer_quantity = taker_type == util::type_buy_offer 
+      ? pricing::quantity(remaining, limit_price, daos_symbol) 
+      : remaining;
+
+    // a sweep that stopped on max_offer_matches or on the taker's own offer
+    // leaves crossing offers behind, the remainder stays in the balance instead
+    if (offer_quantity.amount > 0 && !crosses_book(dao_id, token_id, taker_type, limit_price)) {
+      storeoffer(dao_id, from, offer_quantity, limit_price, token_id, util::status_active, taker_type);
+    }
+  }
+
+}
+
+// true when the best counter-offer of a type offer priced at price would match it,
+// best is the offer sweep_offers would fill first: best price, then the oldest
+bool daoreg::crosses_book(
+  const uint64_t & dao_id,
+  const uint8_t & token_idx,
+  const uint8_t & type,
+  const asset & price) {
+
+  offers_table offer_t(get_self(), dao_id);
+  auto by_offer_match = offer_t.get_index<eosio::name("byoffermatch")>();
+
+  uint8_t counter_type = type == util::type_buy_offer ? util::type_sell_offer : util::type_buy_offer;
+  uint128_t prefix = ( uint128_t(0xF & counter_type) << 124 )
+    + ( uint128_t(0xF & util::status_active) << 122 )
+    + ( uint128_t(0xF & token_idx) << 120 );
+
+  auto best = by_offer_match.end();
+
+  if (type == util::type_buy_offer) {
+    // lowest ask
+    best = by_offer_match.lower_bound(prefix);
+  } else {
+    // highest bid
+    auto upper = by_offer_match.lower_bound(prefix + (uint128_t(1) << 120));
+    if (upper == by_offer_match.begin()) return false;
+    best = std::prev(upper);
+  }
+
+  if (best == by_offer_match.end() || (best->by_offer_match() >> 120) != (prefix >> 120)) return false;
+
+  return type == util::type_buy_offer ? best->price_per_unit <= price : best->price_per_unit >= price;
 
 }
 
@@ -611,12 +1542,78 @@ void daoreg::remove_balance(
   check(itr != balances_by_token_account_token.end(), "Token account and symbol are not registered in your account");
   check(itr->available >= quantity, "You do not have enough balance");
 
+  if (itr->available == quantity && itr->locked.amount == 0 && params.get().erase_empty_balances) {
+    balances_by_token_account_token.erase(itr);
+  } else {
+    balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
+      user.available -= quantity;
+    });
+  }
+
+}
+
+void daoreg::lock_balance(
+  const name & account, 
+  const asset & quantity, 
+  const name & token_account) {
+
+  balances_table _balances(get_self(), account.value);
+
+  auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
+  auto itr = balances_by_token_account_token.find((uint128_t(token_account.value) << 64) + quantity.symbol.raw());
+
+  check(itr != balances_by_token_account_token.end(), "Token account and symbol are not registered in your account");
+  check(itr->available >= quantity, "You do not have enough balance");
+
   balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
     user.available -= quantity;
+    user.locked += quantity;
   });
 
 }
 
+void daoreg::unlock_balance(
+  const name & account, 
+  const asset & quantity, 
+  const name & token_account) {
+
+  balances_table _balances(get_self(), account.value);
+
+  auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
+  auto itr = balances_by_token_account_token.find((uint128_t(token_account.value) << 64) + quantity.symbol.raw());
+
+  check(itr != balances_by_token_account_token.end() && itr->locked >= quantity, "Locked balance is lower than the quantity to unlock");
+
+  if (itr->locked == quantity && itr->available.amount == 0 && params.get().erase_empty_balances) {
+    balances_by_token_account_token.erase(itr);
+  } else {
+    balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
+      user.locked -= quantity;
+    });
+  }
+
+}
+
+// hands the escrowed quantity to the beneficiary and closes the trade,
+// touches the seller's and the beneficiary's balance rows and the trade row only
+void daoreg::settle_trade(
+  const uint64_t & dao_id,
+  const uint64_t & trade_id,
+  const name & beneficiary) {
+
+  trades_table trade_t(get_self(), dao_id);
+  auto titr = trade_t.find(trade_id);
+
+  // credit first so a refund to the seller never erases the row it is about to update
+  add_balance(beneficiary, titr->quantity, titr->token_account, dao_id);
+  unlock_balance(titr->seller, titr->quantity, titr->token_account);
+
+  emit_event(name("logsettle"), dao_id, trade_id, titr->seller, titr->buyer, titr->quantity, beneficiary);
+
+  trade_t.erase(titr);
+
+}
+
 void daoreg::send_transfer(
   const name & beneficiary, 
   const asset & quantity, 
@@ -643,11 +1640,14 @@ void daoreg::send_transfer(
 
 void daoreg::close_offer(
   const uint64_t & dao_id,
-  const uint8_t & offer_id) {
+  const uint64_t & offer_id) {
 
   offers_table offer_t(get_self(), dao_id);
 
   auto ofit = offer_t.find(offer_id);
+  check(ofit != offer_t.end(), "Offer not found");
+
+  emit_event(name("logcancel"), dao_id, ofit->offer_id, ofit->creator, ofit->available_quantity);
 
   offer_t.modify(ofit, get_self(), [&](auto& item){
     item.status = util::status_closed;
@@ -657,40 +1657,78 @@ void daoreg::close_offer(
 
 
 
-void daoreg::transfer(const name & from, const name & to, const asset & quantity, const uint64_t & dao_id) {
+ACTION daoreg::compactbal(const name & account, const uint64_t & start_id, const uint64_t & max_rows) {
 
-  check(quantity.amount > 0, "Amount to transfer has to be higher than zero");
+  require_auth( has_auth(account) ? account : get_self() );
 
-  require_auth( has_auth(from) ? from : get_self() );
+  check(max_rows > 0, "compactbal: max_rows has to be higher than zero");
 
-  /// token_exists(dao_id, quantity);
-  name token_account = get_token_account(dao_id, quantity.symbol);
+  balances_table _balances(get_self(), account.value);
 
-  balances_table _balances(get_self(), from.value);
-  symbol token_symbol = quantity.symbol;
+  // visits at most max_rows rows from start_id on, when it stops early it
+  // prints the id to send as start_id on the next call
+  uint64_t visited = 0;
+  auto itr = _balances.lower_bound(start_id);
 
-  auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
-  auto itr = balances_by_token_account_token.find((uint128_t(token_account.value) << 64) + token_symbol.raw());
+  while (itr != _balances.end() && visited < max_rows) {
+    if (itr->available.amount == 0 && itr->locked.amount == 0) {
+      itr = _balances.erase(itr);
+    } else {
+      itr++;
+    }
+    visited++;
+  }
 
-  check(itr != balances_by_token_account_token.end(), "Token account and symbol are not registered in your account");
-  check(itr->available >= quantity, "You do not have enough balance");
+  if (itr != _balances.end()) {
+    print("{\"next_id\":" + std::to_string(itr->id) + "}");
+  }
 
-  balances_by_token_account_token.modify(itr, get_self(), [&](auto& user){
-    user.available -= quantity;
-  });
+}
+
+ACTION daoreg::transferbatch(
+  const name & from, 
+  const uint64_t & dao_id, 
+  const std::vector<std::pair<name, asset>> & transfers) {
 
+  require_auth(from);
 
-  balances_table _balancesTo(get_self(), to.value);
+  check(transfers.size() > 0, "transferbatch: There are no transfers to make");
 
-  auto balances_by_token_account_tokenTo = _balancesTo.get_index<name("bytkaccttokn")>();
-  auto bitr = balances_by_token_account_tokenTo.find((uint128_t(token_account.value) << 64) + token_symbol.raw());
+  // net the batch first so every balance row is touched once
+  std::map<symbol, asset> debits;
+  std::map<std::pair<name, symbol>, asset> credits;
 
-  check(bitr != balances_by_token_account_tokenTo.end(), "Token account and symbol are not registered in your account");
-  check(bitr->available >= quantity, "You do not have enough balance");
+  for (auto& [to, quantity] : transfers) {
+    check(quantity.is_valid() && quantity.amount > 0, "transferbatch: Amount to transfer has to be higher than zero");
+    check(to != from, "transferbatch: Can not transfer to self");
+    check(is_account(to), "transferbatch: Recipient account does not exist");
 
-  balances_by_token_account_tokenTo.modify(bitr, get_self(), [&](auto& user){
-    user.available += quantity;
-  });
+    auto ditr = debits.find(quantity.symbol);
+    if (ditr == debits.end()) {
+      debits.emplace(quantity.symbol, quantity);
+    } else {
+      ditr->second += quantity;
+    }
+
+    auto citr = credits.find({to, quantity.symbol});
+    if (citr == credits.end()) {
+      credits.emplace(std::make_pair(to, quantity.symbol), quantity);
+    } else {
+      citr->second += quantity;
+    }
+  }
+
+  std::map<symbol, name> token_accounts;
+
+  for (auto& [token_symbol, total] : debits) {
+    name token_account = get_token_account(dao_id, token_symbol);
+    token_accounts.emplace(token_symbol, token_account);
+    remove_balance(from, total, token_account, dao_id);
+  }
+
+  for (auto& [recipient, quantity] : credits) {
+    add_balance(recipient.first, quantity, token_accounts.at(recipient.second), dao_id);
+  }
 
 }
 
@@ -707,6 +1745,17 @@ void daoreg::token_exists(const uint64_t & dao_id, const asset & quantity) {
 
 }
 
+asset daoreg::get_available(const name & account, const name & token_account, const symbol & token_symbol) {
+
+  balances_table _balances(get_self(), account.value);
+
+  auto balances_by_token_account_token = _balances.get_index<name("bytkaccttokn")>();
+  auto itr = balances_by_token_account_token.find((uint128_t(token_account.value) << 64) + token_symbol.raw());
+
+  return itr != balances_by_token_account_token.end() ? itr->available : asset(0, token_symbol);
+
+}
+
 void daoreg::has_enough_balance(const uint64_t & dao_id, const name & account, const asset & quantity) {
   
   // token_exists(dao_id, quantity);
@@ -763,4 +1812,76 @@ name daoreg::get_token_account(const uint64_t & dao_id, const symbol & token_sym
 
   return token_account;
 
-}
\ No newline at end of file
+}
+
+void daoreg::record_trade(
+  const uint64_t & dao_id,
+  const uint8_t & token_idx,
+  const asset & price_per_unit,
+  const asset & quantity,
+  const asset & cost) {
+
+  time_point now = current_time_point();
+  uint32_t now_sec = now.sec_since_epoch();
+
+  lasttrades_table lasttrade_t(get_self(), dao_id);
+  auto ltitr = lasttrade_t.find(token_idx);
+
+  if (ltitr == lasttrade_t.end()) {
+    lasttrade_t.emplace(get_self(), [&](auto& item){
+      item.token_idx = token_idx;
+      item.price_per_unit = price_per_unit;
+      item.quantity = quantity;
+      item.trade_date = now;
+    });
+  } else {
+    lasttrade_t.modify(ltitr, get_self(), [&](auto& item){
+      item.price_per_unit = price_per_unit;
+      item.quantity = quantity;
+      item.trade_date = now;
+    });
+  }
+
+  candles_table candle_t(get_self(), dao_id);
+
+  for (auto& [interval, slots] : util::candle_intervals) {
+
+    // each (token, interval) owns a fixed number of slots, old buckets are overwritten
+    uint64_t slot = (now_sec / interval) % slots;
+    uint64_t candle_id = (uint64_t(token_idx) << 56) + (uint64_t(interval) << 24) + slot;
+    time_point_sec bucket_start(now_sec - (now_sec % interval));
+
+    auto citr = candle_t.find(candle_id);
+
+    if (citr == candle_t.end()) {
+      candle_t.emplace(get_self(), [&](auto& item){
+        item.id = candle_id;
+        item.token_idx = token_idx;
+        item.interval = interval;
+        item.bucket_start = bucket_start;
+        item.open = item.high = item.low = item.close = price_per_unit;
+        item.volume = quantity;
+        item.quote_volume = cost;
+        item.trades = 1;
+      });
+    } else if (citr->bucket_start != bucket_start) {
+      candle_t.modify(citr, get_self(), [&](auto& item){
+        item.bucket_start = bucket_start;
+        item.open = item.high = item.low = item.close = price_per_unit;
+        item.volume = quantity;
+        item.quote_volume = cost;
+        item.trades = 1;
+      });
+    } else {
+      candle_t.modify(citr, get_self(), [&](auto& item){
+        item.high = std::max(item.high, price_per_unit);
+        item.low = std::min(item.low, price_per_unit);
+        item.close = price_per_unit;
+        item.volume += quantity;
+        item.quote_volume += cost;
+        item.trades += 1;
+      });
+    }
+  }
+
+}
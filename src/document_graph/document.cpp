@@ -6,6 +6,8 @@
 
 #include <document_graph/document.hpp>
 #include <document_graph/util.hpp>
+#include <string_codec.hpp>
+#include <value_index.hpp>
 
 namespace hypha
 {
@@ -20,12 +22,12 @@ namespace hypha
     }
 
     Document::Document(eosio::name contract, eosio::name creator, ContentGroup contentGroup)
-        : Document(contract, creator, rollup(contentGroup))
+        : Document(contract, creator, rollup(std::move(contentGroup)))
     {
     }
 
     Document::Document(eosio::name contract, eosio::name creator, Content content)
-        : Document(contract, creator, rollup(content))
+        : Document(contract, creator, rollup(std::move(content)))
     {
     }
 
@@ -47,6 +49,7 @@ namespace hypha
         created_date = h_itr->created_date;
         certificates = h_itr->certificates;
         content_groups = h_itr->content_groups;
+        string_codec::expandGroups(content_groups);
         hashContents();
 
         // this should never happen, only if hash algorithm somehow changed
@@ -66,10 +69,15 @@ namespace hypha
         return false;
     }
 
+    // documents built by getOrNew arrive already hashed, everything else
+    // reaches this point with an empty hash and is hashed here exactly once
     void Document::emplace()
     {
         TRACE_FUNCTION()
-        hashContents();
+        if (hash == eosio::checksum256())
+        {
+            hashContents();
+        }
 
         document_table d_t(getContract(), getContract().value);
         auto hash_index = d_t.get_index<eosio::name("idhash")>();
@@ -78,17 +86,24 @@ namespace hypha
         // if this content exists already, error out and send back the hash of the existing document
         EOS_CHECK(h_itr == hash_index.end(), "document exists already: " + readableHash(hash));
 
+        string_codec::checkPlain(content_groups);
+
+        // the hash above covers the plain strings, the row is written plain and
+        // compressed afterwards by the contract through string_codec::compressDocument
         d_t.emplace(getContract(), [&](auto &d) {
             id = d_t.available_primary_key();
             created_date = eosio::current_time_point();
             d = *this;
         });
+
+        ValueIndex(getContract()).index(hash, content_groups);
     }
 
     Document Document::getOrNew(eosio::name _contract, eosio::name _creator, ContentGroups contentGroups)
     {
         Document document{};
-        document.content_groups = contentGroups;
+        document.contract = _contract;
+        document.content_groups = std::move(contentGroups);
         document.hashContents();
 
         Document::document_table d_t(_contract, _contract.value);
@@ -98,7 +113,6 @@ namespace hypha
         // if this content exists already, return this one
         if (h_itr != hash_index.end())
         {
-            document.contract = _contract;
             document.creator = h_itr->creator;
             document.created_date = h_itr->created_date;
             document.certificates = h_itr->certificates;
@@ -106,17 +120,20 @@ namespace hypha
             return document;
         }
 
-        return Document(_contract, _creator, contentGroups);
+        // reuses the hash computed above
+        document.creator = _creator;
+        document.emplace();
+        return document;
     }
 
     Document Document::getOrNew(eosio::name contract, eosio::name creator, ContentGroup contentGroup)
     {
-        return getOrNew(contract, creator, rollup(contentGroup));
+        return getOrNew(contract, creator, rollup(std::move(contentGroup)));
     }
 
     Document Document::getOrNew(eosio::name contract, eosio::name creator, Content content)
     {
-        return getOrNew(contract, creator, rollup(content));
+        return getOrNew(contract, creator, rollup(std::move(content)));
     }
 
     Document Document::getOrNew(eosio::name contract, eosio::name creator, const std::string &label, const Content::FlexValue &value)
@@ -158,6 +175,8 @@ namespace hypha
         return eosio::sha256(const_cast<char *>(string_data.c_str()), string_data.length());
     }
 
+    // appends in place, the output is the same as the former
+    // results = results + ... form without copying the prefix on every step
     const std::string Document::toString(const ContentGroups &contentGroups)
     {
         std::string results = "[";
@@ -171,12 +190,12 @@ namespace hypha
             }
             else
             {
-                results = results + ",";
+                results += ",";
             }
-            results = results + toString(contentGroup);
+            results += toString(contentGroup);
         }
 
-        results = results + "]";
+        results += "]";
         return results;
     }
 
@@ -193,27 +212,27 @@ namespace hypha
             }
             else
             {
-                results = results + ",";
+                results += ",";
             }
-            results = results + content.toString();
+            results += content.toString();
         }
 
-        results = results + "]";
+        results += "]";
         return results;
     }
 
     ContentGroups Document::rollup(ContentGroup contentGroup)
     {
         ContentGroups contentGroups;
-        contentGroups.push_back(contentGroup);
+        contentGroups.push_back(std::move(contentGroup));
         return contentGroups;
     }
 
     ContentGroups Document::rollup(Content content)
     {
         ContentGroup contentGroup;
-        contentGroup.push_back(content);
-        return rollup(contentGroup);
+        contentGroup.push_back(std::move(content));
+        return rollup(std::move(contentGroup));
     }
 
     /** Example
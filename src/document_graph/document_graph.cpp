@@ -1,6 +1,7 @@
 #include <document_graph/document_graph.hpp>
 #include <document_graph/document.hpp>
 #include <document_graph/util.hpp>
+#include <value_index.hpp>
 #include <logger/logger.hpp>
 
 namespace hypha
@@ -159,8 +160,8 @@ namespace hypha
                                            ContentGroups contentGroups)
     {
         TRACE_FUNCTION()
-        Document currentDocument(m_contract, documentHash);
-        Document newDocument(m_contract, updater, contentGroups);
+        // the current document is not loaded, eraseDocument below fails if it does not exist
+        Document newDocument(m_contract, updater, std::move(contentGroups));
 
         replaceNode(documentHash, newDocument.getHash());
         eraseDocument(documentHash, false);
@@ -182,6 +183,7 @@ namespace hypha
         }
 
         hash_index.erase(h_itr);
+        ValueIndex(m_contract).unindex(documentHash);
     }
 
     void DocumentGraph::eraseDocument(const eosio::checksum256 &documentHash)
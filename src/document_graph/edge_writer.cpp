@@ -0,0 +1,67 @@
+#include <map>
+#include <set>
+
+#include <edge_writer.hpp>
+#include <document_graph/util.hpp>
+#include <logger/logger.hpp>
+
+namespace hypha
+{
+    void writeEdges(const eosio::name &contract, const eosio::name &creator, const std::vector<EdgeSpec> &edges)
+    {
+        TRACE_FUNCTION()
+        Edge::edge_table e_t(contract, contract.value);
+
+        std::map<eosio::checksum256, std::string> readableHashes;
+        std::map<std::pair<eosio::checksum256, eosio::checksum256>, uint64_t> fromToIndexes;
+        std::set<uint64_t> ids;
+
+        auto readable = [&](const eosio::checksum256 &hash) -> const std::string & {
+            auto itr = readableHashes.find(hash);
+            if (itr == readableHashes.end())
+            {
+                itr = readableHashes.emplace(hash, readableHash(hash)).first;
+            }
+            return itr->second;
+        };
+
+        const eosio::time_point now = eosio::current_time_point();
+
+        for (const EdgeSpec &spec : edges)
+        {
+            const std::string &from = readable(spec.fromNode);
+            const std::string &to = readable(spec.toNode);
+            const std::string label = spec.edgeName.to_string();
+
+            // same values concatHash() produces for Edge::write
+            const uint64_t edgeID = toUint64(from + to + label);
+
+            EOS_CHECK(
+              ids.insert(edgeID).second && e_t.find(edgeID) == e_t.end(),
+              util::to_str("Edge from: ", spec.fromNode,
+                           " to: ", spec.toNode,
+                           " with name: ", spec.edgeName, " already exists")
+            );
+
+            auto fromTo = fromToIndexes.find({spec.fromNode, spec.toNode});
+            if (fromTo == fromToIndexes.end())
+            {
+                fromTo = fromToIndexes.emplace(std::make_pair(spec.fromNode, spec.toNode), toUint64(from + to)).first;
+            }
+
+            e_t.emplace(contract, [&](auto &e) {
+                e.id = edgeID;
+                e.from_node_edge_name_index = toUint64(from + label);
+                e.from_node_to_node_index = fromTo->second;
+                e.to_node_edge_name_index = toUint64(to + label);
+                e.creator = creator;
+                e.contract = contract;
+                e.from_node = spec.fromNode;
+                e.to_node = spec.toNode;
+                e.edge_name = spec.edgeName;
+                e.created_date = now;
+            });
+        }
+    }
+
+} // namespace hypha
@@ -0,0 +1,214 @@
+#include <map>
+
+#include <group_store.hpp>
+#include <string_codec.hpp>
+#include <document_graph/content_wrapper.hpp>
+#include <document_graph/util.hpp>
+#include <logger/logger.hpp>
+
+namespace hypha
+{
+    GroupStore::GroupStore(const eosio::name &contract) : m_contract{contract} {}
+
+    ContentGroups GroupStore::store(const ContentGroups &contentGroups, uint32_t compressMinLength)
+    {
+        TRACE_FUNCTION()
+        ContentGroups stubs;
+        stubs.reserve(contentGroups.size());
+
+        for (const ContentGroup &contentGroup : contentGroups)
+        {
+            eosio::checksum256 hash = Document::hashContents(ContentGroups{contentGroup});
+            acquire(hash, contentGroup, 1, compressMinLength);
+            stubs.push_back(makeStub(contentGroup, hash));
+        }
+
+        return stubs;
+    }
+
+    ContentGroups GroupStore::expand(const ContentGroups &contentGroups)
+    {
+        TRACE_FUNCTION()
+        group_table g_t(m_contract, m_contract.value);
+        auto hash_index = g_t.get_index<eosio::name("byhash")>();
+
+        ContentGroups expanded;
+        expanded.reserve(contentGroups.size());
+
+        for (const ContentGroup &contentGroup : contentGroups)
+        {
+            auto hash = getReference(contentGroup);
+            if (!hash)
+            {
+                expanded.push_back(contentGroup);
+                continue;
+            }
+
+            auto g_itr = hash_index.find(*hash);
+            EOS_CHECK(g_itr != hash_index.end(), "stored group not found: " + readableHash(*hash));
+            expanded.push_back(g_itr->content_group);
+            string_codec::expandGroup(expanded.back());
+        }
+
+        return expanded;
+    }
+
+    void GroupStore::release(const ContentGroups &contentGroups)
+    {
+        for (const ContentGroup &contentGroup : contentGroups)
+        {
+            if (auto hash = getReference(contentGroup))
+            {
+                release(*hash, 1);
+            }
+        }
+    }
+
+    ContentGroups GroupStore::replace(const ContentGroups &previous, ContentGroups newGroups, bool dedup, uint32_t compressMinLength)
+    {
+        TRACE_FUNCTION()
+        if (!dedup)
+        {
+            release(previous);
+            return newGroups;
+        }
+
+        // net reference change per group, unchanged groups cancel out
+        std::map<eosio::checksum256, std::pair<int64_t, const ContentGroup *>> deltas;
+
+        for (const ContentGroup &contentGroup : previous)
+        {
+            if (auto hash = getReference(contentGroup))
+            {
+                deltas[*hash].first--;
+            }
+        }
+
+        ContentGroups stubs;
+        stubs.reserve(newGroups.size());
+
+        for (const ContentGroup &contentGroup : newGroups)
+        {
+            eosio::checksum256 hash = Document::hashContents(ContentGroups{contentGroup});
+            auto &delta = deltas[hash];
+            delta.first++;
+            delta.second = &contentGroup;
+            stubs.push_back(makeStub(contentGroup, hash));
+        }
+
+        for (const auto &[hash, delta] : deltas)
+        {
+            if (delta.first > 0)
+            {
+                acquire(hash, *delta.second, delta.first, compressMinLength);
+            }
+            else if (delta.first < 0)
+            {
+                release(hash, -delta.first);
+            }
+        }
+
+        return stubs;
+    }
+
+    bool GroupStore::hasReferences(const ContentGroups &contentGroups)
+    {
+        for (const ContentGroup &contentGroup : contentGroups)
+        {
+            if (getReference(contentGroup))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::optional<eosio::checksum256> GroupStore::getReference(const ContentGroup &contentGroup)
+    {
+        if (contentGroup.empty() || contentGroup.size() > 2)
+        {
+            return std::nullopt;
+        }
+
+        const Content &last = contentGroup.back();
+        if (last.label != GROUP_REF_LABEL || !std::holds_alternative<eosio::checksum256>(last.value))
+        {
+            return std::nullopt;
+        }
+
+        return std::get<eosio::checksum256>(last.value);
+    }
+
+    ContentGroup GroupStore::makeStub(const ContentGroup &contentGroup, const eosio::checksum256 &hash)
+    {
+        ContentGroup stub;
+
+        auto label = ContentWrapper::getGroupLabel(contentGroup);
+        if (!label.empty())
+        {
+            stub.push_back(Content(CONTENT_GROUP_LABEL, std::string(label)));
+        }
+        stub.push_back(Content(GROUP_REF_LABEL, hash));
+
+        return stub;
+    }
+
+    void GroupStore::acquire(const eosio::checksum256 &hash, const ContentGroup &contentGroup, uint64_t count, uint32_t compressMinLength)
+    {
+        group_table g_t(m_contract, m_contract.value);
+        group_refs_table r_t(m_contract, m_contract.value);
+
+        auto hash_index = g_t.get_index<eosio::name("byhash")>();
+        auto g_itr = hash_index.find(hash);
+
+        if (g_itr == hash_index.end())
+        {
+            uint64_t id = g_t.available_primary_key();
+
+            g_t.emplace(m_contract, [&](auto &g) {
+                g.id = id;
+                g.hash = hash;
+                g.content_group = contentGroup;
+                string_codec::compressGroup(g.content_group, compressMinLength);
+            });
+
+            r_t.emplace(m_contract, [&](auto &r) {
+                r.group_id = id;
+                r.refs = count;
+            });
+            return;
+        }
+
+        auto r_itr = r_t.find(g_itr->id);
+        EOS_CHECK(r_itr != r_t.end(), "group refs not found: " + readableHash(hash));
+
+        r_t.modify(r_itr, m_contract, [&](auto &r) {
+            r.refs += count;
+        });
+    }
+
+    void GroupStore::release(const eosio::checksum256 &hash, uint64_t count)
+    {
+        group_table g_t(m_contract, m_contract.value);
+        group_refs_table r_t(m_contract, m_contract.value);
+
+        auto hash_index = g_t.get_index<eosio::name("byhash")>();
+        auto g_itr = hash_index.find(hash);
+        EOS_CHECK(g_itr != hash_index.end(), "stored group not found: " + readableHash(hash));
+
+        auto r_itr = r_t.find(g_itr->id);
+        EOS_CHECK(r_itr != r_t.end(), "group refs not found: " + readableHash(hash));
+
+        if (r_itr->refs <= count)
+        {
+            r_t.erase(r_itr);
+            hash_index.erase(g_itr);
+            return;
+        }
+
+        r_t.modify(r_itr, m_contract, [&](auto &r) {
+            r.refs -= count;
+        });
+    }
+
+} // namespace hypha
@@ -0,0 +1,242 @@
+#include <array>
+
+#include <string_codec.hpp>
+#include <document_graph/document.hpp>
+#include <document_graph/util.hpp>
+#include <logger/logger.hpp>
+
+namespace hypha
+{
+    namespace string_codec
+    {
+        namespace
+        {
+            constexpr size_t MIN_MATCH = 4;
+            constexpr size_t MAX_MATCH = 0x7F + MIN_MATCH;
+            constexpr size_t MAX_LITERALS = 0x80;
+            constexpr size_t MAX_DISTANCE = 0xFFFF;
+            constexpr size_t HASH_BITS = 12;
+            constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+            // last position seen for each 4 byte hash, kept out of the 8 KB
+            // wasm stack and cleared on every compress call
+            std::array<uint32_t, size_t(1) << HASH_BITS> table;
+
+            uint32_t hash4(const char *p)
+            {
+                uint32_t v = uint32_t(uint8_t(p[0])) | (uint32_t(uint8_t(p[1])) << 8) |
+                             (uint32_t(uint8_t(p[2])) << 16) | (uint32_t(uint8_t(p[3])) << 24);
+                return (v * 2654435761u) >> (32 - HASH_BITS);
+            }
+
+            void flushLiterals(std::string &out, std::string_view in, size_t start, size_t end)
+            {
+                while (start < end)
+                {
+                    size_t run = std::min(end - start, MAX_LITERALS);
+                    out.push_back(char(run - 1));
+                    out.append(in.data() + start, run);
+                    start += run;
+                }
+            }
+
+            template <typename F>
+            void forEachString(ContentGroup &contentGroup, F &&f)
+            {
+                for (Content &content : contentGroup)
+                {
+                    if (auto value = std::get_if<std::string>(&content.value))
+                    {
+                        f(*value);
+                    }
+                }
+            }
+        } // namespace
+
+        bool isCompressed(std::string_view value)
+        {
+            return value.size() >= MARKER.size() && value.substr(0, MARKER.size()) == MARKER;
+        }
+
+        std::string compress(std::string_view in)
+        {
+            std::string out = MARKER;
+            out.reserve(MARKER.size() + in.size() + in.size() / MAX_LITERALS + 1);
+
+            table.fill(NO_POSITION);
+
+            size_t literalStart = 0;
+            size_t pos = 0;
+
+            while (pos + MIN_MATCH <= in.size())
+            {
+                uint32_t h = hash4(in.data() + pos);
+                uint32_t candidate = table[h];
+                table[h] = uint32_t(pos);
+
+                size_t length = 0;
+                if (candidate != NO_POSITION && pos - candidate <= MAX_DISTANCE)
+                {
+                    size_t limit = std::min(in.size() - pos, MAX_MATCH);
+                    while (length < limit && in[candidate + length] == in[pos + length])
+                    {
+                        length++;
+                    }
+                }
+
+                if (length < MIN_MATCH)
+                {
+                    pos++;
+                    continue;
+                }
+
+                flushLiterals(out, in, literalStart, pos);
+
+                size_t distance = pos - candidate;
+                out.push_back(char(0x80 | (length - MIN_MATCH)));
+                out.push_back(char(distance & 0xFF));
+                out.push_back(char(distance >> 8));
+
+                pos += length;
+                literalStart = pos;
+            }
+
+            flushLiterals(out, in, literalStart, in.size());
+            return out;
+        }
+
+        std::string expand(std::string_view in)
+        {
+            EOS_CHECK(isCompressed(in), "string is not compressed");
+
+            std::string out;
+            out.reserve(in.size() * 2);
+
+            size_t pos = MARKER.size();
+            while (pos < in.size())
+            {
+                uint8_t control = uint8_t(in[pos++]);
+
+                if (control < 0x80)
+                {
+                    size_t run = size_t(control) + 1;
+                    EOS_CHECK(pos + run <= in.size(), "corrupt compressed string: literal run past the end");
+                    out.append(in.data() + pos, run);
+                    pos += run;
+                    continue;
+                }
+
+                EOS_CHECK(pos + 2 <= in.size(), "corrupt compressed string: truncated match");
+                size_t length = size_t(control & 0x7F) + MIN_MATCH;
+                size_t distance = size_t(uint8_t(in[pos])) | (size_t(uint8_t(in[pos + 1])) << 8);
+                pos += 2;
+
+                EOS_CHECK(distance > 0 && distance <= out.size(), "corrupt compressed string: bad match distance");
+
+                // byte by byte, matches may overlap the bytes they produce
+                size_t from = out.size() - distance;
+                for (size_t i = 0; i < length; ++i)
+                {
+                    out.push_back(out[from + i]);
+                }
+            }
+
+            return out;
+        }
+
+        bool compressGroup(ContentGroup &contentGroup, uint32_t minLength)
+        {
+            bool changed = false;
+
+            if (minLength == 0)
+            {
+                return changed;
+            }
+
+            forEachString(contentGroup, [&](std::string &value) {
+                if (value.size() < minLength)
+                {
+                    return;
+                }
+
+                std::string compressed = compress(value);
+                if (compressed.size() < value.size())
+                {
+                    value = std::move(compressed);
+                    changed = true;
+                }
+            });
+
+            return changed;
+        }
+
+        void expandGroup(ContentGroup &contentGroup)
+        {
+            forEachString(contentGroup, [](std::string &value) {
+                if (isCompressed(value))
+                {
+                    value = expand(value);
+                }
+            });
+        }
+
+        bool compressGroups(ContentGroups &contentGroups, uint32_t minLength)
+        {
+            bool changed = false;
+
+            for (ContentGroup &contentGroup : contentGroups)
+            {
+                changed |= compressGroup(contentGroup, minLength);
+            }
+
+            return changed;
+        }
+
+        void compressDocument(const eosio::name &contract, const eosio::checksum256 &hash, uint32_t minLength)
+        {
+            if (minLength == 0)
+            {
+                return;
+            }
+
+            Document::document_table d_t(contract, contract.value);
+            auto hash_index = d_t.get_index<eosio::name("idhash")>();
+            auto h_itr = hash_index.find(hash);
+            EOS_CHECK(h_itr != hash_index.end(), "document not found: " + readableHash(hash));
+
+            ContentGroups contentGroups = h_itr->getContentGroups();
+            if (!compressGroups(contentGroups, minLength))
+            {
+                return;
+            }
+
+            hash_index.modify(h_itr, contract, [&](auto &d) {
+                d.getContentGroups() = std::move(contentGroups);
+            });
+        }
+
+        void expandGroups(ContentGroups &contentGroups)
+        {
+            for (ContentGroup &contentGroup : contentGroups)
+            {
+                expandGroup(contentGroup);
+            }
+        }
+
+        void checkPlain(const ContentGroups &contentGroups)
+        {
+            for (const ContentGroup &contentGroup : contentGroups)
+            {
+                for (const Content &content : contentGroup)
+                {
+                    if (auto value = std::get_if<std::string>(&content.value))
+                    {
+                        EOS_CHECK(!isCompressed(*value), "content " + content.label + " starts with the reserved compression marker");
+                    }
+                }
+            }
+        }
+
+    } // namespace string_codec
+
+} // namespace hypha
@@ -0,0 +1,115 @@
+#include <deque>
+#include <set>
+
+#include <graph_traversal.hpp>
+#include <document_graph/util.hpp>
+#include <logger/logger.hpp>
+
+namespace hypha
+{
+    GraphTraversal::GraphTraversal(const eosio::name &contract) : m_contract{contract} {}
+
+    uint32_t GraphTraversal::bfs(const eosio::checksum256 &start, const TraversalOptions &options, const Visitor &visitor)
+    {
+        TRACE_FUNCTION()
+        std::deque<TraversalNode> queue;
+        std::set<eosio::checksum256> seen{start};
+        uint32_t visits = 0;
+
+        queue.push_back(TraversalNode{start, 0, eosio::name(), std::nullopt});
+
+        while (!queue.empty() && visits < options.maxVisits)
+        {
+            TraversalNode node = std::move(queue.front());
+            queue.pop_front();
+
+            if (options.loadDocuments)
+            {
+                node.document.emplace(m_contract, node.hash);
+            }
+
+            visits++;
+            if (!visitor(node))
+            {
+                break;
+            }
+
+            if (node.depth >= options.maxDepth)
+            {
+                continue;
+            }
+
+            // queued nodes count against maxVisits, edges are only read while
+            // the budget has room for another node
+            expand(node, options, [&](const Edge &edge) {
+                if (seen.insert(edge.to_node).second)
+                {
+                    queue.push_back(TraversalNode{edge.to_node, uint8_t(node.depth + 1), edge.edge_name, std::nullopt});
+                }
+                return visits + queue.size() < options.maxVisits;
+            });
+        }
+
+        return visits;
+    }
+
+    std::vector<eosio::checksum256> GraphTraversal::reachable(const eosio::checksum256 &start, const TraversalOptions &options)
+    {
+        std::vector<eosio::checksum256> hashes;
+
+        bfs(start, options, [&](const TraversalNode &node) {
+            if (node.depth > 0)
+            {
+                hashes.push_back(node.hash);
+            }
+            return true;
+        });
+
+        return hashes;
+    }
+
+    // without a filter the exact fromnode index is scanned, with one the
+    // byfromname index narrows the scan to the wanted edges, its hashed key can
+    // collide so the row fields are checked as well, onEdge returns false to
+    // stop reading edges
+    void GraphTraversal::expand(const TraversalNode &node,
+                                const TraversalOptions &options,
+                                const std::function<bool(const Edge &)> &onEdge)
+    {
+        Edge::edge_table e_t(m_contract, m_contract.value);
+
+        if (options.edgeNames.empty())
+        {
+            auto from_node_index = e_t.get_index<eosio::name("fromnode")>();
+            auto itr = from_node_index.find(node.hash);
+
+            while (itr != from_node_index.end() && itr->from_node == node.hash)
+            {
+                if (!onEdge(*itr))
+                {
+                    return;
+                }
+                itr++;
+            }
+            return;
+        }
+
+        auto from_name_index = e_t.get_index<eosio::name("byfromname")>();
+
+        for (const auto &edgeName : options.edgeNames)
+        {
+            uint64_t index = concatHash(node.hash, edgeName);
+            auto itr = from_name_index.find(index);
+
+            while (itr != from_name_index.end() && itr->by_from_node_edge_name_index() == index)
+            {
+                if (itr->from_node == node.hash && itr->edge_name == edgeName && !onEdge(*itr))
+                {
+                    return;
+                }
+                itr++;
+            }
+        }
+    }
+
+} // namespace hypha
@@ -0,0 +1,168 @@
+#include <algorithm>
+
+#include <value_index.hpp>
+#include <group_store.hpp>
+#include <document_graph/content_wrapper.hpp>
+#include <document_graph/util.hpp>
+#include <logger/logger.hpp>
+
+namespace hypha
+{
+    ValueIndex::ValueIndex(const eosio::name &contract) : m_contract{contract} {}
+
+    bool ValueIndex::declare(const std::string &groupLabel, const std::string &contentLabel)
+    {
+        indexed_field_table f_t(m_contract, m_contract.value);
+
+        for (const auto &field : f_t)
+        {
+            if (field.group_label == groupLabel && field.content_label == contentLabel)
+            {
+                return false;
+            }
+        }
+
+        f_t.emplace(m_contract, [&](auto &f) {
+            f.id = f_t.available_primary_key();
+            f.group_label = groupLabel;
+            f.content_label = contentLabel;
+        });
+        return true;
+    }
+
+    // the entries of the field go with it, a field declared later may reuse its id
+    bool ValueIndex::undeclare(const std::string &groupLabel, const std::string &contentLabel)
+    {
+        indexed_field_table f_t(m_contract, m_contract.value);
+
+        for (auto itr = f_t.begin(); itr != f_t.end(); ++itr)
+        {
+            if (itr->group_label == groupLabel && itr->content_label == contentLabel)
+            {
+                const uint64_t fieldId = itr->id;
+                f_t.erase(itr);
+
+                value_entry_table v_t(m_contract, m_contract.value);
+                auto field_value_index = v_t.get_index<eosio::name("byfieldval")>();
+                auto v_itr = field_value_index.lower_bound(
+                    eosio::checksum256::make_from_word_sequence<uint64_t>(fieldId, 0ULL, 0ULL, 0ULL));
+
+                while (v_itr != field_value_index.end() && v_itr->field_id == fieldId)
+                {
+                    v_itr = field_value_index.erase(v_itr);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ValueIndex::index(const eosio::checksum256 &documentHash, const ContentGroups &contentGroups)
+    {
+        indexed_field_table f_t(m_contract, m_contract.value);
+        if (f_t.begin() == f_t.end())
+        {
+            return;
+        }
+
+        // documents written through the group store only hold stubs
+        ContentGroups expanded;
+        const ContentGroups *groups = &contentGroups;
+        if (GroupStore::hasReferences(contentGroups))
+        {
+            expanded = GroupStore(m_contract).expand(contentGroups);
+            groups = &expanded;
+        }
+
+        value_entry_table v_t(m_contract, m_contract.value);
+
+        for (const ContentGroup &contentGroup : *groups)
+        {
+            auto groupLabel = ContentWrapper::getGroupLabel(contentGroup);
+            if (groupLabel.empty())
+            {
+                continue;
+            }
+
+            for (const auto &field : f_t)
+            {
+                if (field.group_label != groupLabel)
+                {
+                    continue;
+                }
+
+                for (const Content &content : contentGroup)
+                {
+                    if (content.label != field.content_label || content.isEmpty())
+                    {
+                        continue;
+                    }
+
+                    v_t.emplace(m_contract, [&](auto &v) {
+                        v.id = v_t.available_primary_key();
+                        v.field_id = field.id;
+                        v.value_hash = hashValue(content.label, content.value);
+                        v.document_hash = documentHash;
+                    });
+                }
+            }
+        }
+    }
+
+    void ValueIndex::unindex(const eosio::checksum256 &documentHash)
+    {
+        value_entry_table v_t(m_contract, m_contract.value);
+        auto document_index = v_t.get_index<eosio::name("bydocument")>();
+        auto itr = document_index.find(documentHash);
+
+        while (itr != document_index.end() && itr->document_hash == documentHash)
+        {
+            itr = document_index.erase(itr);
+        }
+    }
+
+    std::vector<eosio::checksum256> ValueIndex::find(const std::string &groupLabel,
+                                                     const std::string &contentLabel,
+                                                     const Content::FlexValue &value,
+                                                     uint32_t limit)
+    {
+        std::vector<eosio::checksum256> documents;
+
+        indexed_field_table f_t(m_contract, m_contract.value);
+        auto field = std::find_if(f_t.begin(), f_t.end(), [&](const auto &f) {
+            return f.group_label == groupLabel && f.content_label == contentLabel;
+        });
+        EOS_CHECK(field != f_t.end(), "field is not indexed: " + groupLabel + "." + contentLabel);
+
+        const eosio::checksum256 valueHash = hashValue(contentLabel, value);
+        const uint64_t valueWord = ValueEntry::leadingWord(valueHash.extract_as_byte_array().data());
+
+        value_entry_table v_t(m_contract, m_contract.value);
+        auto field_value_index = v_t.get_index<eosio::name("byfieldval")>();
+        auto itr = field_value_index.lower_bound(
+            eosio::checksum256::make_from_word_sequence<uint64_t>(field->id, valueWord, 0ULL, 0ULL));
+
+        for (; itr != field_value_index.end() && documents.size() < limit; ++itr)
+        {
+            if (itr->field_id != field->id || ValueEntry::leadingWord(itr->value_hash.extract_as_byte_array().data()) != valueWord)
+            {
+                break;
+            }
+
+            // the range key only holds 64 bits of the value hash
+            if (itr->value_hash == valueHash)
+            {
+                documents.push_back(itr->document_hash);
+            }
+        }
+
+        return documents;
+    }
+
+    eosio::checksum256 ValueIndex::hashValue(const std::string &contentLabel, const Content::FlexValue &value)
+    {
+        std::string data = Content(contentLabel, value).toString();
+        return eosio::sha256(data.c_str(), data.length());
+    }
+
+} // namespace hypha
@@ -97,6 +97,39 @@ void tlostoken::transfer(const name &from,
     add_balance( to, quantity, payer );
 }
 
+void tlostoken::transfermany(const name &from,
+                             const std::vector<transfer_entry> &transfers)
+{
+    require_auth( from );
+    check( transfers.size() > 0, "must transfer to at least one account" );
+
+    auto sym = transfers[0].quantity.symbol.code();
+    stats statstable( get_self(), sym.raw() );
+    const auto& st = statstable.get( sym.raw() );
+
+    require_recipient( from );
+
+    asset total( 0, st.supply.symbol );
+
+    for( const auto& t : transfers ) {
+       check( from != t.to, "cannot transfer to self" );
+       check( is_account( t.to ), "to account does not exist");
+       check( t.quantity.is_valid(), "invalid quantity" );
+       check( t.quantity.amount > 0, "must transfer positive quantity" );
+       check( t.quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+       check( t.memo.size() <= 256, "memo has more than 256 bytes" );
+
+       require_recipient( t.to );
+       total += t.quantity;
+    }
+
+    sub_balance( from, total );
+
+    for( const auto& t : transfers ) {
+       add_balance( t.to, t.quantity, from );
+    }
+}
+
 void tlostoken::sub_balance(const name &owner, const asset &value)
 {
    accounts from_acnts( get_self(), owner.value );
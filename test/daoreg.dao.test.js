@@ -8,7 +8,7 @@ const { EnvironmentUtil } = require('./util/EnvironmentUtil')
 const { TokenUtil } = require('./util/TokenUtil')
 const { DaosFactory } = require('./util/DaoUtil')
 const expect = require('chai').expect
-const { daoreg, tlostoken } = contractNames
+const { daoreg, daoinf, tlostoken } = contractNames
 
 
 
@@ -29,7 +29,7 @@ describe('Tests for dao registry', async function () {
     await sleep(4000)
     await EnvironmentUtil.deployContracts(configContracts)
 
-    contracts = await getContracts([daoreg, tlostoken])
+    contracts = await getContracts([daoreg, daoinf, tlostoken])
 
     await updatePermissions()
 
@@ -52,14 +52,14 @@ describe('Tests for dao registry', async function () {
 
   it('Create a new configuration parameter', async function () {
     // Arrange
-    const settings = ['testparam', ['uint64', 20], 'test param']
+    const settings = ['b.rambytes', ['uint64', 20], 'test param']
 
     // Act
     await contracts.daoreg.setparam(...settings, { authorization: `${daoreg}@active` })
     // Assert
     settingsTable = await getParams()
 
-    expect(settingsTable[3]).to.deep.equals({ // the contract begins with 3 prev params
+    expect(settingsTable.find(row => row.key === settings[0])).to.deep.equals({
       key: settings[0],
       value: settings[1],
       description: settings[2]
@@ -67,6 +67,26 @@ describe('Tests for dao registry', async function () {
 
   })
 
+  it('Unknown configuration parameters are rejected', async function () {
+    // Arrange
+    let error
+    let fail
+
+    // Act
+    try {
+      await contracts.daoreg.setparam('testparam', ['uint64', 20], 'test param', { authorization: `${daoreg}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+      error = err
+    }
+
+    // Assert
+    expect(fail).to.be.true
+    assertError({ error, textInside: 'setparam: unknown parameter', verbose: false })
+
+  })
+
   it('Create a new DAO:', async function () {
     // Arrange
     const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
@@ -228,6 +248,205 @@ describe('Tests for dao registry', async function () {
   })
 
 
+  it('Creating and deleting a DAO keeps the daoinf node in sync', async function () {
+
+    // Arrange
+    await contracts.daoinf.reset({ authorization: `${daoinf}@active` })
+    await contracts.daoreg.setparam('info.account', ['name', daoinf], 'Account of the daoinf contract', { authorization: `${daoreg}@active` })
+    await contracts.daoinf.setindexed('fixed_details', 'creator', true, { authorization: `${daoinf}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    const actionParams = dao.getActionParams()
+
+    const getEdges = async () => (await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'edges',
+      json: true,
+      limit: 100
+    })).rows
+
+    const getIndexedValues = async () => (await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'valueindex',
+      json: true,
+      limit: 100
+    })).rows
+
+    // Act
+    await contracts.daoreg.create(...actionParams, { authorization: `${dao.params.creator}@active` })
+
+    // Assert
+    let edges = await getEdges()
+    expect(edges.length).to.equals(3)
+    expect(edges.filter(e => e.edge_name === 'daos').length).to.equals(1)
+    expect((await getIndexedValues()).length).to.equals(1)
+
+    // Act
+    await contracts.daoreg.delorg(1, { authorization: `${daoreg}@active` })
+
+    // Assert
+    edges = await getEdges()
+    expect(edges.map(e => e.edge_name)).to.deep.equals(['hasdaos'])
+    expect(await getIndexedValues()).to.deep.equals([])
+
+  })
+
+  it('Undeclaring an indexed field removes its values', async function () {
+
+    // Arrange
+    await contracts.daoinf.reset({ authorization: `${daoinf}@active` })
+    await contracts.daoreg.setparam('info.account', ['name', daoinf], 'Account of the daoinf contract', { authorization: `${daoreg}@active` })
+    await contracts.daoinf.setindexed('fixed_details', 'creator', true, { authorization: `${daoinf}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+
+    const getIndexedValues = async () => (await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'valueindex',
+      json: true,
+      limit: 100
+    })).rows
+
+    expect((await getIndexedValues()).length).to.equals(1)
+
+    // Act
+    await contracts.daoinf.setindexed('fixed_details', 'creator', false, { authorization: `${daoinf}@active` })
+    await contracts.daoinf.setindexed('fixed_details', 'dao', true, { authorization: `${daoinf}@active` })
+
+    // Assert
+    // the new field takes the id of the undeclared one without inheriting its values
+    expect(await getIndexedValues()).to.deep.equals([])
+
+  })
+
+  it('Deleting a dao info node in chunks continues until the node is gone', async function () {
+
+    // Arrange
+    await contracts.daoinf.reset({ authorization: `${daoinf}@active` })
+    await contracts.daoreg.setparam('info.account', ['name', daoinf], 'Account of the daoinf contract', { authorization: `${daoreg}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+
+    // Act
+    await contracts.daoinf.deldao(1, 1, { authorization: `${daoinf}@active` })
+
+    // Assert
+    const edges = await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'edges',
+      json: true,
+      limit: 100
+    })
+
+    expect(edges.rows.map(e => e.edge_name)).to.deep.equals(['hasdaos'])
+
+    const index = await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'daoindex',
+      json: true,
+      limit: 100
+    })
+
+    expect(index.rows.length).to.equals(0)
+
+  })
+
+  it('DAO info entries can not forge stored group references', async function () {
+
+    // Arrange
+    await contracts.daoinf.reset({ authorization: `${daoinf}@active` })
+    await contracts.daoinf.setgraphcfg(true, 0, { authorization: `${daoinf}@active` })
+    await contracts.daoreg.setparam('info.account', ['name', daoinf], 'Account of the daoinf contract', { authorization: `${daoreg}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+
+    const groups = await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'groups',
+      json: true,
+      limit: 100
+    })
+
+    const forged = [{
+      dao_id: 1,
+      group_label: 'forged',
+      contents: [{ label: 'group_ref', value: ['checksum256', groups.rows[0].hash] }]
+    }]
+
+    let error
+    let fail
+
+    // Act
+    try {
+      await contracts.daoinf.storeentries(forged, { authorization: `${dao.params.creator}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+      error = err
+    }
+
+    // Assert
+    expect(fail).to.be.true
+    assertError({ error, textInside: 'content label group_ref is reserved', verbose: false })
+
+  })
+
+  it('The dao index keeps the creation time of the info node across updates', async function () {
+
+    // Arrange
+    await contracts.daoinf.reset({ authorization: `${daoinf}@active` })
+    await contracts.daoreg.setparam('info.account', ['name', daoinf], 'Account of the daoinf contract', { authorization: `${daoreg}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+
+    const getIndex = async () => (await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'daoindex',
+      json: true,
+      limit: 100
+    })).rows
+
+    const getDocument = async (hash) => (await rpc.get_table_rows({
+      code: daoinf,
+      scope: daoinf,
+      table: 'documents',
+      json: true,
+      limit: 100
+    })).rows.find(doc => doc.hash === hash)
+
+    const [created] = await getIndex()
+    expect(created.created_date).to.equals((await getDocument(created.info_hash)).created_date)
+
+    await sleep(2000)
+
+    // Act
+    await contracts.daoinf.storeentries([{
+      dao_id: 1,
+      group_label: 'variable_details',
+      contents: [{ label: 'website', value: ['string', 'https://example.com'] }]
+    }], { authorization: `${dao.params.creator}@active` })
+
+    await contracts.daoinf.indexdaos(1, 10, { authorization: `${daoinf}@active` })
+
+    // Assert
+    const [updated] = await getIndex()
+    expect(updated.info_hash).to.not.equals(created.info_hash)
+    expect(updated.created_date).to.equals(created.created_date)
+    expect((await getDocument(updated.info_hash)).created_date).to.not.equals(created.created_date)
+
+  })
+
   it('Delete DAO', async function () {
 
     // Arrange
@@ -1,4 +1,4 @@
-const { rpc } = require('../scripts/eos')
+const { rpc, transact } = require('../scripts/eos')
 const { getContracts, initContract, createRandomAccount, Asset } = require('../scripts/eosio-util')
 const { contractNames, contracts: configContracts, isLocalNode, sleep } = require('../scripts/config')
 const { setParamsValue } = require('../scripts/contract-settings')
@@ -7,6 +7,7 @@ const { EnvironmentUtil } = require('./util/EnvironmentUtil')
 const { TokenUtil } = require('./util/TokenUtil')
 const { DaosFactory } = require('./util/DaoUtil')
 const { OffersFactory, OfferConstants } = require('./util/OfferUtil')
+const { assertError } = require('../scripts/eosio-errors')
 const expect = require('chai').expect
 const { daoreg, tlostoken } = contractNames
 
@@ -18,6 +19,7 @@ describe('Tests for offers in dao registry', async function () {
   let bob, alice, dao_creator
 
   let eosio_token_contract
+  let dtk_contract
   const eosio_account = 'eosio.token'
 
   before(async function () {
@@ -92,6 +94,7 @@ describe('Tests for offers in dao registry', async function () {
 
     // create & register token in dao
     let [token_contract, token_account] = await TokenUtil.createTokenContract()
+    dtk_contract = token_contract
 
     // token is created
     await TokenUtil.create({
@@ -330,6 +333,38 @@ describe('Tests for offers in dao registry', async function () {
   })
 
 
+  it('Offer events are emitted and forwarded to the log account', async function () {
+
+    // Arrange
+    const logAccount = await createRandomAccount()
+    await contracts.daoreg.setparam('log.account', ['name', logAccount], 'Account notified of every event', { authorization: `${daoreg}@active` })
+
+    const offer = await OffersFactory.createWithDefaults({ creator: alice, type: OfferConstants.sell })
+    const actionOfferCreateParams = offer.getActionParams()
+
+    // Act
+    const res = await contracts.daoreg.createoffer(...actionOfferCreateParams, { authorization: `${offer.params.creator}@active` })
+
+    // Assert
+    const flatten = (traces) => traces.flatMap(trace => [trace, ...flatten(trace.inline_traces || [])])
+    const events = flatten(res.processed.action_traces)
+      .filter(trace => trace.act.account === daoreg && trace.act.name === 'lognewoffer')
+
+    expect(events.map(trace => trace.receiver)).to.have.members([daoreg, logAccount])
+
+    for (const trace of events) {
+      expect(trace.act.data).to.deep.equals({
+        dao_id: 1,
+        offer_id: 0,
+        creator: alice,
+        quantity: offer.params.quantity,
+        price_per_unit: offer.params.price_per_unit,
+        type: OfferConstants.sell
+      })
+    }
+
+  })
+
   it('Offer match - sell offer is accepted insted of create a new one', async function () {
 
 
@@ -432,6 +467,785 @@ describe('Tests for offers in dao registry', async function () {
 
   })
 
+  it('Offer match - last trade and candles are updated', async function () {
+
+    // Arrange
+    const offer_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${offer_sell.params.creator}@active` })
+
+    const offer_buy = await OffersFactory.createWithDefaults({ creator: alice, type: OfferConstants.buy })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    // Act
+    await contracts.daoreg.createoffer(...offer_buy.getActionParams(), { authorization: `${offer_buy.params.creator}@active` })
+
+    // Assert
+    const lastTradeTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'lasttrades',
+      json: true,
+      limit: 100
+    })
+
+    expect(lastTradeTable.rows).to.deep.equals([{
+      token_idx: 1,
+      price_per_unit: offer_sell.params.price_per_unit,
+      quantity: offer_sell.params.quantity,
+      trade_date: lastTradeTable.rows[0].trade_date
+    }])
+
+    const candlesTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'candles',
+      json: true,
+      limit: 100
+    })
+
+    expect(candlesTable.rows.map(c => c.interval)).to.have.members([60, 3600, 86400])
+
+    for (const candle of candlesTable.rows) {
+      expect(candle.open).to.equals(offer_sell.params.price_per_unit)
+      expect(candle.close).to.equals(offer_sell.params.price_per_unit)
+      expect(candle.volume).to.equals(offer_sell.params.quantity)
+      expect(candle.quote_volume).to.equals(`0.1000 ${TokenUtil.tokenCode}`)
+      expect(candle.trades).to.equals(1)
+    }
+
+  })
+
+  it('Deposit with an offer memo fills the best counter-offer and withdraws the proceeds', async function () {
+
+    // Arrange
+    const offer_buy = await OffersFactory.createWithDefaults({ creator: alice, type: OfferConstants.buy })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    await contracts.daoreg.createoffer(...offer_buy.getActionParams(), { authorization: `${offer_buy.params.creator}@active` })
+
+    await TokenUtil.transfer({
+      amount: "1.0000 DTK",
+      sender: daoreg,
+      reciever: bob,
+      dao_id: "",
+      contract: dtk_contract
+    })
+
+    // Act
+    await TokenUtil.transfer({
+      amount: "1.0000 DTK",
+      sender: bob,
+      reciever: daoreg,
+      dao_id: `1:offer:${offer_buy.params.price_per_unit.split(' ')[0]}:w`,
+      contract: dtk_contract
+    })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.length).to.equals(1)
+    expect(offerTable.rows[0].available_quantity).to.equals("0.0000 DTK")
+    expect(offerTable.rows[0].status).to.equals(OfferConstants.close)
+
+    await TokenUtil.confirmBalance({
+      code: eosio_account,
+      scope: bob,
+      token: TokenUtil.tokenCode,
+      balance_available: '1000.1000'
+    })
+
+    const alicesBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(alicesBalance.rows[0].available).to.equals("101.0000 DTK")
+    expect(alicesBalance.rows[1].available).to.equals("0.0000 TLOS")
+
+  })
+
+  it('Deposit with an offer memo does not rest a remainder that crosses the book', async function () {
+
+    // Arrange
+    const offer_sell = await OffersFactory.createWithDefaults({ creator: alice, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${alice}@active` })
+
+    // Act
+    await TokenUtil.transfer({
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: `1:offer:${offer_sell.params.price_per_unit.split(' ')[0]}:DTK`,
+      contract: eosio_token_contract
+    })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.length).to.equals(1)
+    expect(offerTable.rows[0].type).to.equals(OfferConstants.sell)
+    expect(offerTable.rows[0].status).to.equals(OfferConstants.open)
+
+  })
+
+  it('Deposit with an offer memo fills the oldest ask of the best price level first', async function () {
+
+    // Arrange
+    const first_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...first_sell.getActionParams(), { authorization: `${bob}@active` })
+
+    // offers are ordered by their creation second
+    await sleep(1500)
+
+    const second_sell = await OffersFactory.createWithDefaults({ creator: dao_creator, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...second_sell.getActionParams(), { authorization: `${dao_creator}@active` })
+
+    // Act
+    await TokenUtil.transfer({
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: `1:offer:${first_sell.params.price_per_unit.split(' ')[0]}:DTK`,
+      contract: eosio_token_contract
+    })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.map(row => [row.creator, row.available_quantity, row.status])).to.deep.equals([
+      [bob, "0.0000 DTK", OfferConstants.close],
+      [dao_creator, second_sell.params.quantity, OfferConstants.open]
+    ])
+
+  })
+
+  it('Deposit of a system token to a dao without an offer memo needs the dao to register it', async function () {
+
+    // Arrange
+    let fail
+    try {
+      await TokenUtil.transfer({
+        amount: `10.0000 ${TokenUtil.tokenCode}`,
+        sender: alice,
+        reciever: daoreg,
+        dao_id: "1",
+        contract: eosio_token_contract
+      })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    expect(fail).to.be.true
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: eosio_account,
+      token_symbol: `4,${TokenUtil.tokenCode}`,
+      daoCreator: dao_creator,
+      contract: contracts.daoreg
+    })
+
+    // Act
+    await TokenUtil.transfer({
+      amount: `10.0000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "1",
+      contract: eosio_token_contract
+    })
+
+    // Assert
+    const alicesBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    const tlosBalance = alicesBalance.rows.filter(row => row.token_account === eosio_account)
+
+    expect(tlosBalance.length).to.equals(1)
+    expect(tlosBalance[0].available).to.equals(`10.0000 ${TokenUtil.tokenCode}`)
+    expect(tlosBalance[0].dao_id).to.equals(1)
+
+  })
+
+  it('Market offers - immediate or cancel fills what it can and fill or kill fails as a whole', async function () {
+
+    // Arrange
+    const offer_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${offer_sell.params.creator}@active` })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.3000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    const ioc_buy = OffersFactory.createEntry({
+      daoId: 1,
+      creator: alice,
+      quantity: "2.0000 DTK",
+      price_per_unit: offer_sell.params.price_per_unit,
+      type: OfferConstants.iocBuy
+    })
+
+    // Act
+    await contracts.daoreg.createoffer(...ioc_buy.getActionParams(), { authorization: `${alice}@active` })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.length).to.equals(1)
+    expect(offerTable.rows[0].available_quantity).to.equals("0.0000 DTK")
+    expect(offerTable.rows[0].status).to.equals(OfferConstants.close)
+
+    // Act
+    const fok_buy = OffersFactory.createEntry({
+      daoId: 1,
+      creator: alice,
+      quantity: "1.0000 DTK",
+      price_per_unit: offer_sell.params.price_per_unit,
+      type: OfferConstants.fokBuy
+    })
+
+    let fail
+    try {
+      await contracts.daoreg.createoffer(...fok_buy.getActionParams(), { authorization: `${alice}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    // Assert
+    expect(fail).to.be.true
+
+  })
+
+  it('Market offers - an offer whose maker can no longer pay is closed and skipped', async function () {
+
+    // Arrange
+    const offer_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${bob}@active` })
+
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    await TokenUtil.withdraw({
+      account: bob,
+      token_contract: bobsBalance.rows[0].token_account,
+      amount: bobsBalance.rows[0].available,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    const ioc_buy = OffersFactory.createEntry({
+      daoId: 1,
+      creator: alice,
+      quantity: offer_sell.params.quantity,
+      price_per_unit: offer_sell.params.price_per_unit,
+      type: OfferConstants.iocBuy
+    })
+
+    // Act
+    await contracts.daoreg.createoffer(...ioc_buy.getActionParams(), { authorization: `${alice}@active` })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.length).to.equals(1)
+    expect(offerTable.rows[0].available_quantity).to.equals(offer_sell.params.quantity)
+    expect(offerTable.rows[0].status).to.equals(OfferConstants.close)
+
+  })
+
+  it('Market offers - an unfunded maker with an offer id above 255 is closed by its own id', async function () {
+
+    // Arrange
+    // alice rests 256 asks far above the book so the next offer gets id 256
+    for (let batch = 0; batch < 8; batch++) {
+      const resting_sell = OffersFactory.createEntry({
+        daoId: 1,
+        creator: alice,
+        quantity: `0.0001 DTK`,
+        price_per_unit: `${100 + batch}.0000 ${TokenUtil.tokenCode}`,
+        type: OfferConstants.sell
+      })
+
+      await transact({
+        actions: Array.from({ length: 32 }, () => ({
+          account: daoreg,
+          name: 'createoffer',
+          authorization: [{
+            actor: alice,
+            permission: 'active',
+          }],
+          data: {
+            dao_id: 1,
+            creator: alice,
+            quantity: resting_sell.params.quantity,
+            price_per_unit: resting_sell.params.price_per_unit,
+            type: resting_sell.params.type
+          }
+        }))
+      })
+    }
+
+    const offer_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${bob}@active` })
+
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    await TokenUtil.withdraw({
+      account: bob,
+      token_contract: bobsBalance.rows[0].token_account,
+      amount: bobsBalance.rows[0].available,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    const ioc_buy = OffersFactory.createEntry({
+      daoId: 1,
+      creator: alice,
+      quantity: offer_sell.params.quantity,
+      price_per_unit: offer_sell.params.price_per_unit,
+      type: OfferConstants.iocBuy
+    })
+
+    // Act
+    await contracts.daoreg.createoffer(...ioc_buy.getActionParams(), { authorization: `${alice}@active` })
+
+    // Assert
+    const bobsOffer = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      lower_bound: 256,
+      upper_bound: 256,
+      json: true,
+      limit: 1
+    })
+
+    expect(bobsOffer.rows[0].creator).to.equals(bob)
+    expect(bobsOffer.rows[0].status).to.equals(OfferConstants.close)
+
+    const alicesOffer = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      lower_bound: 0,
+      upper_bound: 0,
+      json: true,
+      limit: 1
+    })
+
+    expect(alicesOffer.rows[0].creator).to.equals(alice)
+    expect(alicesOffer.rows[0].status).to.equals(OfferConstants.open)
+
+  })
+
+  it('Pricing - costs that do not fit in an asset are rejected at extreme prices', async function () {
+
+    // Arrange
+    // 100 DTK at 10^14 TLOS each, the 128 bit product holds but the cost is above asset::max_amount
+    const extremePrice = `100000000000000.0000 ${TokenUtil.tokenCode}`
+
+    for (const type of [OfferConstants.buy, OfferConstants.iocBuy]) {
+      const offer = OffersFactory.createEntry({
+        daoId: 1,
+        creator: alice,
+        quantity: "100.0000 DTK",
+        price_per_unit: extremePrice,
+        type
+      })
+
+      // Act
+      let fail, error
+      try {
+        await contracts.daoreg.createoffer(...offer.getActionParams(), { authorization: `${alice}@active` })
+        fail = false
+      } catch (err) {
+        fail = true
+        error = err
+      }
+
+      // Assert
+      expect(fail).to.be.true
+      assertError({ error, textInside: 'pricing: cost is out of range', verbose: false })
+    }
+
+  })
+
+  it('Pricing - fills at the smallest unit round the cost up and the funded quantity down', async function () {
+
+    // Arrange
+    const offer_sell = OffersFactory.createEntry({
+      daoId: 1,
+      creator: bob,
+      quantity: "1.0000 DTK",
+      price_per_unit: `0.0003 ${TokenUtil.tokenCode}`,
+      type: OfferConstants.sell
+    })
+    await contracts.daoreg.createoffer(...offer_sell.getActionParams(), { authorization: `${bob}@active` })
+
+    // Act
+    // 0.0001 TLOS funds 0.3333 DTK (rounded down), whose exact cost of 0.00009999 TLOS is rounded up
+    await TokenUtil.transfer({
+      amount: `0.0001 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: `1:offer:0.0003:DTK`,
+      contract: eosio_token_contract
+    })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.length).to.equals(1)
+    expect(offerTable.rows[0].available_quantity).to.equals("0.6667 DTK")
+    expect(offerTable.rows[0].status).to.equals(OfferConstants.open)
+
+    const alicesBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(alicesBalance.rows.find(row => row.available.endsWith('DTK')).available).to.equals("100.3333 DTK")
+
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(bobsBalance.rows.find(row => row.available.endsWith('DTK')).available).to.equals("99.6667 DTK")
+    expect(bobsBalance.rows.find(row => row.available.endsWith(TokenUtil.tokenCode)).available).to.equals(`0.0001 ${TokenUtil.tokenCode}`)
+
+  })
+
+  it('Amend an offer in place', async function () {
+
+    // Arrange
+    const offer = await OffersFactory.createWithDefaults({ creator: alice, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...offer.getActionParams(), { authorization: `${alice}@active` })
+
+    const getOffers = async () => (await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })).rows
+
+    const [created] = await getOffers()
+
+    // Act
+    await contracts.daoreg.amendoffer(1, created.offer_id, "0.5000 DTK", offer.params.price_per_unit, { authorization: `${alice}@active` })
+
+    // Assert
+    let [amended] = await getOffers()
+    expect(amended.offer_id).to.equals(created.offer_id)
+    expect(amended.available_quantity).to.equals("0.5000 DTK")
+    expect(amended.total_quantity).to.equals("0.5000 DTK")
+    expect(amended.creation_date).to.equals(created.creation_date)
+
+    // Act
+    await contracts.daoreg.amendoffer(1, created.offer_id, "0.5000 DTK", "0.2000 TLOS", { authorization: `${alice}@active` })
+
+    // Assert
+    const offers = await getOffers()
+    expect(offers.length).to.equals(1)
+    expect(offers[0].offer_id).to.equals(created.offer_id)
+    expect(offers[0].price_per_unit).to.equals("0.2000 TLOS")
+
+  })
+
+  it('Amending an offer to a larger quantity moves it behind the offers of its price level', async function () {
+
+    // Arrange
+    const first_sell = await OffersFactory.createWithDefaults({ creator: bob, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...first_sell.getActionParams(), { authorization: `${bob}@active` })
+
+    // offers are ordered by their creation second
+    await sleep(1500)
+
+    const second_sell = await OffersFactory.createWithDefaults({ creator: dao_creator, type: OfferConstants.sell })
+    await contracts.daoreg.createoffer(...second_sell.getActionParams(), { authorization: `${dao_creator}@active` })
+
+    await sleep(1500)
+
+    await contracts.daoreg.amendoffer(1, 0, "2.0000 DTK", first_sell.params.price_per_unit, { authorization: `${bob}@active` })
+
+    await TokenUtil.transfer({ // deposit to dao
+      amount: `0.1000 ${TokenUtil.tokenCode}`,
+      sender: alice,
+      reciever: daoreg,
+      dao_id: "0",
+      contract: eosio_token_contract
+    })
+
+    const ioc_buy = OffersFactory.createEntry({
+      daoId: 1,
+      creator: alice,
+      quantity: "1.0000 DTK",
+      price_per_unit: first_sell.params.price_per_unit,
+      type: OfferConstants.iocBuy
+    })
+
+    // Act
+    await contracts.daoreg.createoffer(...ioc_buy.getActionParams(), { authorization: `${alice}@active` })
+
+    // Assert
+    const offerTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'offers',
+      json: true,
+      limit: 100
+    })
+
+    expect(offerTable.rows.map(row => [row.creator, row.available_quantity, row.status])).to.deep.equals([
+      [bob, "2.0000 DTK", OfferConstants.open],
+      [dao_creator, "0.0000 DTK", OfferConstants.close]
+    ])
+
+  })
+
+  it('Escrowed fiat trade - seller releases after the buyer confirms the payment', async function () {
+
+    // Arrange
+    const arbiter = await createRandomAccount()
+
+    for (const account of [alice, bob, arbiter]) {
+      await contracts.daoreg.upsertuser(account, [], 'utc', 'usd', { authorization: `${account}@active` })
+    }
+    await contracts.daoreg.setarbiter(arbiter, true, { authorization: `${daoreg}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+
+    // Act
+    await contracts.daoreg.opentrade(1, bob, alice, '10.0000 DTK', '25.00 USD', 'wire', arbiter, { authorization: `${bob}@active` })
+
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(bobsBalance.rows[0].available).to.equals('90.0000 DTK')
+    expect(bobsBalance.rows[0].locked).to.equals('10.0000 DTK')
+
+    await contracts.daoreg.confirmpaid(1, 0, { authorization: `${alice}@active` })
+    await contracts.daoreg.releasetrade(1, 0, { authorization: `${bob}@active` })
+
+    // Assert
+    const tradesTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: 1,
+      table: 'trades',
+      json: true,
+      limit: 100
+    })
+
+    expect(tradesTable.rows.length).to.equals(0)
+
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      balance_available: '90.0000 DTK',
+      balance_locked: '0.0000 DTK',
+      id: 0,
+      dao_id: 1,
+      token_account: bobsBalance.rows[0].token_account
+    })
+
+    const alicesBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(alicesBalance.rows[0].available).to.equals('110.0000 DTK')
+
+  })
+
+  it('Escrowed fiat trade - settling a whole balance erases the row when erase.empty is on', async function () {
+
+    // Arrange
+    const arbiter = await createRandomAccount()
+
+    for (const account of [alice, bob, arbiter]) {
+      await contracts.daoreg.upsertuser(account, [], 'utc', 'usd', { authorization: `${account}@active` })
+    }
+    await contracts.daoreg.setarbiter(arbiter, true, { authorization: `${daoreg}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+    await contracts.daoreg.setparam('erase.empty', ['uint64', 1], 'Erase balance rows once they are empty (1) or keep them (0)', { authorization: `${daoreg}@active` })
+
+    await contracts.daoreg.opentrade(1, bob, alice, '100.0000 DTK', '250.00 USD', 'wire', arbiter, { authorization: `${bob}@active` })
+
+    // Act
+    await contracts.daoreg.confirmpaid(1, 0, { authorization: `${alice}@active` })
+    await contracts.daoreg.releasetrade(1, 0, { authorization: `${bob}@active` })
+
+    // Assert
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(bobsBalance.rows.filter(row => row.available.endsWith('DTK')).length).to.equals(0)
+
+    const alicesBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(alicesBalance.rows[0].available).to.equals('200.0000 DTK')
+
+  })
+
+  it('Escrowed fiat trade - the buyer can not confirm the payment after the payment window', async function () {
+
+    // Arrange
+    const arbiter = await createRandomAccount()
+
+    for (const account of [alice, bob, arbiter]) {
+      await contracts.daoreg.upsertuser(account, [], 'utc', 'usd', { authorization: `${account}@active` })
+    }
+    await contracts.daoreg.setarbiter(arbiter, true, { authorization: `${daoreg}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+    await contracts.daoreg.setparam('trade.window', ['uint64', 1], 'Seconds the buyer has to confirm a fiat payment', { authorization: `${daoreg}@active` })
+
+    await contracts.daoreg.opentrade(1, bob, alice, '10.0000 DTK', '25.00 USD', 'wire', arbiter, { authorization: `${bob}@active` })
+
+    await sleep(3000)
+
+    // Act
+    let fail, error
+    try {
+      await contracts.daoreg.confirmpaid(1, 0, { authorization: `${alice}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+      error = err
+    }
+
+    // Assert
+    expect(fail).to.be.true
+    assertError({ error, textInside: 'confirmpaid: Payment window is over', verbose: false })
+
+    await contracts.daoreg.canceltrade(1, 0, bob, { authorization: `${bob}@active` })
+
+    const bobsBalance = await rpc.get_table_rows({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(bobsBalance.rows[0].available).to.equals('100.0000 DTK')
+    expect(bobsBalance.rows[0].locked).to.equals('0.0000 DTK')
+
+  })
+
   /*
     it('Create more offers', async function () {
   
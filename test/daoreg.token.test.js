@@ -543,6 +543,119 @@ describe('Tests for tokens in dao registry', async function () {
   })
 
 
+  it(`Transfer the new token to many accounts in one action`, async function () {
+    // Arrange
+    const alice = await createRandomAccount()
+    const bob = await createRandomAccount()
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+    await TokenUtil.createWithErrors({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    //Act
+    await token_contract.transfermany(daoreg, [
+      { to: alice, quantity: `100.0000 ${TokenUtil.tokenTest}`, memo: 'airdrop' },
+      { to: bob, quantity: `50.0000 ${TokenUtil.tokenTest}`, memo: 'airdrop' }
+    ], { authorization: `${daoreg}@active` })
+
+    //Assert
+    await TokenUtil.confirmBalance({
+      code: token_account,
+      scope: alice,
+      token: TokenUtil.tokenTest,
+      balance_available: '100.0000'
+    })
+
+    await TokenUtil.confirmBalance({
+      code: token_account,
+      scope: bob,
+      token: TokenUtil.tokenTest,
+      balance_available: '50.0000'
+    })
+
+    await TokenUtil.confirmBalance({
+      code: token_account,
+      scope: daoreg,
+      token: TokenUtil.tokenTest,
+      balance_available: '3850.0000'
+    })
+
+  })
+
+  it(`Transfer many deposits the entries addressed to daoreg`, async function () {
+    // Arrange
+    const alice = await createRandomAccount()
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.create({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    await TokenUtil.transfer({
+      amount: `100.0000 ${TokenUtil.tokenTest}`,
+      sender: daoreg,
+      reciever: dao.params.creator,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    //Act
+    await token_contract.transfermany(dao.params.creator, [
+      { to: alice, quantity: `10.0000 ${TokenUtil.tokenTest}`, memo: 'airdrop' },
+      { to: daoreg, quantity: `25.0000 ${TokenUtil.tokenTest}`, memo: '1' }
+    ], { authorization: `${dao.params.creator}@active` })
+
+    //Assert
+    await TokenUtil.confirmBalance({
+      code: token_account,
+      scope: alice,
+      token: TokenUtil.tokenTest,
+      balance_available: '10.0000'
+    })
+
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: dao.params.creator,
+      table: 'balances',
+      balance_available: `25.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+  })
+
   it("The transferred account does not exist", async function () {
     //Arrange
     let fail
@@ -864,6 +977,68 @@ describe('Tests for tokens in dao registry', async function () {
 
   })
 
+  it('Deposit with a dao_id:account memo credits the account', async function () {
+
+    // Arrange
+    const alice = await createRandomAccount()
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    const actionParams = dao.getActionParams()
+    await contracts.daoreg.create(...actionParams, { authorization: `${dao.params.creator}@active` })
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.create({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    await TokenUtil.transfer({
+      amount: `100.0000 ${TokenUtil.tokenTest}`,
+      sender: daoreg,
+      reciever: dao.params.creator,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    //Act
+    await TokenUtil.transfer({
+      amount: `25.0000 ${TokenUtil.tokenTest}`,
+      sender: dao.params.creator,
+      reciever: daoreg,
+      dao_id: `1:${alice}`,
+      contract: token_contract
+    })
+
+    // Assert
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      balance_available: `25.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+  })
+
   it('Transfer memo can not be empty, especify dao_id', async function () {
     // Arrange
     let fail
@@ -1612,6 +1787,295 @@ describe('Tests for tokens in dao registry', async function () {
 
   })
 
+  it('Sync registry rebuilds the token registry from the registered dao tokens', async function () {
+    //Arrange
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    await contracts.daoreg.create(...dao.getActionParams(), { authorization: `${dao.params.creator}@active` })
+
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    //Act
+    await contracts.daoreg.syncregistry(0, 10, { authorization: `${daoreg}@active` })
+
+    //Assert
+    const registry = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'tokenreg',
+      json: true,
+      limit: 100
+    })
+
+    expect(registry.rows).to.deep.equals([{
+      token_account: token_account,
+      tokens: 1
+    }])
+
+  })
+
+  it('Compact balances erases the empty rows of an account', async function () {
+    //Arrange
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    const actionParams = dao.getActionParams()
+    await contracts.daoreg.create(...actionParams, { authorization: `${dao.params.creator}@active` })
+
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.createWithErrors({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    await TokenUtil.transfer({
+      amount: `100.0000 ${TokenUtil.tokenTest}`,
+      sender: daoreg,
+      reciever: dao.params.creator,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.transfer({
+      amount: `75.0000 ${TokenUtil.tokenTest}`,
+      sender: dao.params.creator,
+      reciever: daoreg,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.withdraw({
+      account: dao.params.creator,
+      token_contract: token_account,
+      amount: `75.0000 ${TokenUtil.tokenTest}`,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: dao.params.creator,
+      table: 'balances',
+      balance_available: `0.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+    //Act
+    await contracts.daoreg.compactbal(dao.params.creator, 0, 10, { authorization: `${dao.params.creator}@active` })
+
+    //Assert
+    const balances = await rpc.get_table_rows({
+      code: daoreg,
+      scope: dao.params.creator,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(balances.rows).to.deep.equals([])
+
+  })
+
+  it('Withdraw many assets in one action and erase the emptied rows', async function () {
+    //Arrange
+    await contracts.daoreg.setparam('erase.empty', ['uint64', 1], 'Erase balance rows once they are empty (1) or keep them (0)', { authorization: `${daoreg}@active` })
+
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    const actionParams = dao.getActionParams()
+    await contracts.daoreg.create(...actionParams, { authorization: `${dao.params.creator}@active` })
+
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.createWithErrors({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    await TokenUtil.transfer({
+      amount: `100.0000 ${TokenUtil.tokenTest}`,
+      sender: daoreg,
+      reciever: dao.params.creator,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.transfer({
+      amount: `75.0000 ${TokenUtil.tokenTest}`,
+      sender: dao.params.creator,
+      reciever: daoreg,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    //Act
+    await TokenUtil.withdrawMany({
+      account: dao.params.creator,
+      withdrawals: [
+        { first: token_account, second: `50.0000 ${TokenUtil.tokenTest}` },
+        { first: token_account, second: `25.0000 ${TokenUtil.tokenTest}` }
+      ],
+      contract: contracts.daoreg
+    })
+
+    //Assert
+    const balances = await rpc.get_table_rows({
+      code: daoreg,
+      scope: dao.params.creator,
+      table: 'balances',
+      json: true,
+      limit: 100
+    })
+
+    expect(balances.rows).to.deep.equals([])
+
+    await TokenUtil.confirmBalance({
+      code: token_account,
+      scope: dao.params.creator,
+      token: TokenUtil.tokenTest,
+      balance_available: '100.0000'
+    })
+
+  })
+
+  it('Transfer batch credits every recipient and debits the sender once', async function () {
+    //Arrange
+    const dao = await DaosFactory.createWithDefaults({ dao: 'firstdao' })
+    const actionParams = dao.getActionParams()
+    await contracts.daoreg.create(...actionParams, { authorization: `${dao.params.creator}@active` })
+
+    const [token_contract, token_account] = await TokenUtil.createTokenContract();
+
+    await TokenUtil.createWithErrors({
+      issuer: daoreg,
+      maxSupply: `10000.0000 ${TokenUtil.tokenTest}`,
+      contractAccount: token_account,
+      contract: token_contract
+    })
+
+    await TokenUtil.issue({
+      supply: `4000.0000 ${TokenUtil.tokenTest}`,
+      issuer: daoreg,
+      contract: token_contract,
+      memo: 'issued token'
+    })
+
+    await TokenUtil.transfer({
+      amount: `100.0000 ${TokenUtil.tokenTest}`,
+      sender: daoreg,
+      reciever: dao.params.creator,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    await TokenUtil.addTokenToDao({
+      dao_id: 1,
+      token_contract: token_account,
+      token_symbol: `4,${TokenUtil.tokenTest}`,
+      daoCreator: dao.params.creator,
+      contract: contracts.daoreg
+    })
+
+    await TokenUtil.transfer({
+      amount: `75.0000 ${TokenUtil.tokenTest}`,
+      sender: dao.params.creator,
+      reciever: daoreg,
+      dao_id: 1,
+      contract: token_contract
+    })
+
+    const alice = await createRandomAccount()
+    const bob = await createRandomAccount()
+
+    //Act
+    await TokenUtil.transferBatch({
+      from: dao.params.creator,
+      dao_id: 1,
+      transfers: [
+        { first: alice, second: `10.0000 ${TokenUtil.tokenTest}` },
+        { first: bob, second: `5.0000 ${TokenUtil.tokenTest}` },
+        { first: alice, second: `5.0000 ${TokenUtil.tokenTest}` }
+      ],
+      contract: contracts.daoreg
+    })
+
+    //Assert
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: dao.params.creator,
+      table: 'balances',
+      balance_available: `55.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: alice,
+      table: 'balances',
+      balance_available: `15.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+    await TokenUtil.checkBalance({
+      code: daoreg,
+      scope: bob,
+      table: 'balances',
+      balance_available: `5.0000 ${TokenUtil.tokenTest}`,
+      balance_locked: `0.0000 ${TokenUtil.tokenTest}`,
+      id: 0,
+      dao_id: 1,
+      token_account: token_account
+    })
+
+  })
+
   it('Can not withdraw, not enough balance', async function () {
     //Arrange
     let fail
@@ -0,0 +1,300 @@
+const { rpc } = require('../scripts/eos')
+const { getContracts, createRandomAccount } = require('../scripts/eosio-util')
+const { contractNames, contracts: configContracts, isLocalNode, sleep } = require('../scripts/config')
+const { setParamsValue } = require('../scripts/contract-settings')
+const { updatePermissions } = require('../scripts/permissions')
+const { EnvironmentUtil } = require('./util/EnvironmentUtil')
+const expect = require('chai').expect
+const { daoreg } = contractNames
+
+describe('Tests for users and payment methods in dao registry', async function () {
+
+  let contracts
+
+  // test accounts
+  let bob, alice, carol
+
+  before(async function () {
+    if (!isLocalNode()) {
+      console.log('These tests should only be run on a local node')
+      process.exit(1)
+    }
+  })
+
+  beforeEach(async function () {
+    await EnvironmentUtil.initNode()
+    await sleep(4000)
+    await EnvironmentUtil.deployContracts(configContracts)
+    contracts = await getContracts([daoreg])
+
+    await updatePermissions()
+
+    await setParamsValue()
+
+    bob = await createRandomAccount()
+    alice = await createRandomAccount()
+    carol = await createRandomAccount()
+  })
+
+  afterEach(async function () {
+    await EnvironmentUtil.killNode()
+
+  })
+
+  it('Upsert a user and keep the payment methods in sync', async function () {
+    // Arrange
+    await contracts.daoreg.upsertuser(bob, [{ key: 'telegram', value: '@bob' }], 'utc', 'usd', { authorization: `${bob}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+
+    // Act
+    await contracts.daoreg.upsertuser(bob, [], 'cet', 'eur', { authorization: `${bob}@active` })
+
+    // Assert
+    const usersTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'users',
+      json: true,
+      limit: 100
+    })
+
+    expect(usersTable.rows).to.deep.equals([{
+      account: bob,
+      contact_methods: [],
+      time_zone: 'cet',
+      fiat_currency: 'eur',
+      is_arbiter: 0
+    }])
+
+    const paymethodsTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'paymethods',
+      json: true,
+      limit: 100
+    })
+
+    expect(paymethodsTable.rows).to.deep.equals([{
+      id: 0,
+      account: bob,
+      method: 'wire',
+      fiat_currency: 'eur',
+      time_zone: 'cet',
+      details: 'IBAN 0000'
+    }])
+
+  })
+
+  it('Delete a user and its payment methods', async function () {
+    // Arrange
+    for (const account of [bob, alice]) {
+      await contracts.daoreg.upsertuser(account, [], 'utc', 'usd', { authorization: `${account}@active` })
+      await contracts.daoreg.addpaymethod(account, 'wire', 'IBAN 0000', { authorization: `${account}@active` })
+      await contracts.daoreg.addpaymethod(account, 'cash', 'in person', { authorization: `${account}@active` })
+    }
+
+    // Act
+    await contracts.daoreg.deluser(bob, { authorization: `${bob}@active` })
+
+    // Assert
+    const usersTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'users',
+      json: true,
+      limit: 100
+    })
+
+    expect(usersTable.rows.map(row => row.account)).to.deep.equals([alice])
+
+    const paymethodsTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'paymethods',
+      json: true,
+      limit: 100
+    })
+
+    expect(paymethodsTable.rows.map(row => row.account)).to.deep.equals([alice, alice])
+
+    let fail
+    try {
+      await contracts.daoreg.deluser(bob, { authorization: `${bob}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    expect(fail).to.be.true
+
+  })
+
+  it('Add, update and delete a payment method', async function () {
+    // Arrange
+    let fail
+    try {
+      await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    expect(fail).to.be.true
+
+    await contracts.daoreg.upsertuser(bob, [], 'utc', 'usd', { authorization: `${bob}@active` })
+
+    // Act
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 1111', { authorization: `${bob}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'cash', 'in person', { authorization: `${bob}@active` })
+    await contracts.daoreg.delpaymethod(bob, 'cash', { authorization: `${bob}@active` })
+
+    // Assert
+    const paymethodsTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'paymethods',
+      json: true,
+      limit: 100
+    })
+
+    expect(paymethodsTable.rows.map(row => [row.method, row.details])).to.deep.equals([['wire', 'IBAN 1111']])
+
+    try {
+      await contracts.daoreg.delpaymethod(bob, 'cash', { authorization: `${bob}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    expect(fail).to.be.true
+
+    try {
+      await contracts.daoreg.addpaymethod(bob, 'cash', 'x'.repeat(257), { authorization: `${bob}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    expect(fail).to.be.true
+
+  })
+
+  it('Only the contract can set arbiters', async function () {
+    // Arrange
+    let fail
+    await contracts.daoreg.upsertuser(bob, [], 'utc', 'usd', { authorization: `${bob}@active` })
+
+    // Act
+    try {
+      await contracts.daoreg.setarbiter(bob, true, { authorization: `${bob}@active` })
+      fail = false
+    } catch (err) {
+      fail = true
+    }
+
+    await contracts.daoreg.setarbiter(bob, true, { authorization: `${daoreg}@active` })
+
+    // Assert
+    expect(fail).to.be.true
+
+    const usersTable = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'users',
+      json: true,
+      limit: 100
+    })
+
+    expect(usersTable.rows[0].is_arbiter).to.equals(1)
+
+  })
+
+  it('Arbiters are listed by currency through the byarbiter index', async function () {
+    // Arrange
+    await contracts.daoreg.upsertuser(bob, [], 'utc', 'usd', { authorization: `${bob}@active` })
+    await contracts.daoreg.upsertuser(alice, [], 'cet', 'eur', { authorization: `${alice}@active` })
+    await contracts.daoreg.upsertuser(carol, [], 'utc', 'usd', { authorization: `${carol}@active` })
+
+    // Act
+    await contracts.daoreg.setarbiter(bob, true, { authorization: `${daoreg}@active` })
+    await contracts.daoreg.setarbiter(alice, true, { authorization: `${daoreg}@active` })
+
+    // Assert
+    // the key is is_arbiter in the high 64 bits and the currency in the low ones
+    const arbiters = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'users',
+      index_position: 4,
+      key_type: 'i128',
+      lower_bound: '18446744073709551616',
+      json: true,
+      limit: 100
+    })
+
+    expect(arbiters.rows.map(row => [row.account, row.fiat_currency])).to.deep.equals([[alice, 'eur'], [bob, 'usd']])
+
+  })
+
+  it('Payment methods are ordered by account and method through the byacctmethod index', async function () {
+    // Arrange
+    for (const account of [bob, alice]) {
+      await contracts.daoreg.upsertuser(account, [], 'utc', 'usd', { authorization: `${account}@active` })
+    }
+
+    // Act
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+    await contracts.daoreg.addpaymethod(alice, 'wire', 'IBAN 1111', { authorization: `${alice}@active` })
+    await contracts.daoreg.addpaymethod(bob, 'cash', 'in person', { authorization: `${bob}@active` })
+
+    // Assert
+    const byAccount = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'paymethods',
+      index_position: 2,
+      key_type: 'i128',
+      json: true,
+      limit: 100
+    })
+
+    // name values sort like the names themselves
+    const expected = [[bob, 'cash'], [bob, 'wire'], [alice, 'wire']]
+      .sort((a, b) => a[0] < b[0] ? -1 : a[0] > b[0] ? 1 : 0)
+
+    expect(byAccount.rows.map(row => [row.account, row.method])).to.deep.equals(expected)
+
+  })
+
+  it('Payment methods are ordered by currency, method and zone through the bycurmethzn index', async function () {
+    // Arrange
+    await contracts.daoreg.upsertuser(bob, [], 'utc', 'usd', { authorization: `${bob}@active` })
+    await contracts.daoreg.upsertuser(alice, [], 'cet', 'eur', { authorization: `${alice}@active` })
+    await contracts.daoreg.upsertuser(carol, [], 'utc', 'usd', { authorization: `${carol}@active` })
+
+    // Act
+    await contracts.daoreg.addpaymethod(bob, 'wire', 'IBAN 0000', { authorization: `${bob}@active` })
+    await contracts.daoreg.addpaymethod(alice, 'wire', 'IBAN 1111', { authorization: `${alice}@active` })
+    await contracts.daoreg.addpaymethod(carol, 'cash', 'in person', { authorization: `${carol}@active` })
+
+    // Assert
+    const byCurrency = await rpc.get_table_rows({
+      code: daoreg,
+      scope: daoreg,
+      table: 'paymethods',
+      index_position: 3,
+      key_type: 'sha256',
+      json: true,
+      limit: 100
+    })
+
+    expect(byCurrency.rows.map(row => [row.fiat_currency, row.method, row.account])).to.deep.equals([
+      ['eur', 'wire', alice],
+      ['usd', 'cash', carol],
+      ['usd', 'wire', bob]
+    ])
+
+  })
+
+})
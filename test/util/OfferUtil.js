@@ -3,6 +3,10 @@ const { createRandomAccount } = require('../../scripts/eosio-util')
 const OfferConstants = {
   sell  : 0,
   buy   : 1,
+  iocSell : 2,
+  iocBuy  : 3,
+  fokSell : 4,
+  fokBuy  : 5,
   close : 0,
   open  : 1
 }
@@ -134,6 +134,14 @@ class TokenUtil {
     await contract.withdraw(account, token_contract, amount, { authorization: `${account}@active` })
   }
 
+  static async withdrawMany({ account, withdrawals, contract }) {
+    await contract.withdrawmany(account, withdrawals, { authorization: `${account}@active` })
+  }
+
+  static async transferBatch({ from, dao_id, transfers, contract }) {
+    await contract.transferbatch(from, dao_id, transfers, { authorization: `${from}@active` })
+  }
+
   static async resetsttngs({ account, contract }) {
     await contract.resetsttngs({ authorization: `${account}@active` })
   }